@@ -0,0 +1,240 @@
+#include <math.h>
+#include "AIBatch.h"
+#include "GameManager.h"
+#include "simd.h"
+
+// Float builds do AIInput's arithmetic in floats, which the double
+// kernels below wouldn't match; they (and compilers without vector
+// extensions) just run each bot's AIInput.
+#if defined(PING_SIMD) && !defined(PING_FLOAT)
+#define PING_AI_BATCH_SIMD
+
+static doublev sqrtv(doublev x) {
+    for (int lane = 0; lane < SIMD_WIDTH; lane++)
+        x[lane] = sqrt(x[lane]);
+    return x;
+}
+#endif
+
+void AIBatch::add(int player, AIInput::Difficulty difficulty) {
+    unsigned int k = 0;
+    while (k < bots.size() && bots[k].difficulty <= difficulty)
+        k++;
+    bots.insert(bots.begin() + k, AIInput(difficulty));
+    players.insert(players.begin() + k, player);
+}
+
+void AIBatch::remove(int player) {
+    for (unsigned int k = 0; k < players.size(); k++) {
+        if (players[k] == player) {
+            bots.erase(bots.begin() + k);
+            players.erase(players.begin() + k);
+            return;
+        }
+    }
+}
+
+void AIBatch::clear() {
+    bots.clear();
+    players.clear();
+}
+
+unsigned int AIBatch::size() const {
+    return bots.size();
+}
+
+void AIBatch::update(SharedState &state, std::vector<int> &inputs) {
+#ifndef PING_AI_BATCH_SIMD
+    for (unsigned int k = 0; k < bots.size(); k++)
+        inputs[players[k]] = bots[k].update(state, players[k]);
+#else
+    // The last vector of each range can run past its end: into the
+    // next difficulty's bots (whose kernel runs later, overwriting
+    // anything written there) or into the padding.
+    unsigned int padded = bots.size() + SIMD_WIDTH;
+    ballNums.resize(padded);
+    for (std::vector<double> *array : { &paddleX, &paddleY, &halfW, &halfH, &paddleW, &paddleH, &cosOrientation, &sinOrientation, &chosen,
+                                        &midX, &midY, &dirX, &dirY, &ballX, &ballY, &ballDX, &ballDY, &cornerX, &cornerY, &paddleV,
+                                        &startX, &startY, &elapsed, &found, &interceptX, &interceptY, &predictionTime,
+                                        &predicted, &time, &changes })
+        array->resize(padded);
+
+    gather(state);
+
+    unsigned int begin = 0;
+    for (int d = 0; d <= AIInput::HARD; d++) {
+        unsigned int end = begin;
+        while (end < bots.size() && bots[end].difficulty == d)
+            end++;
+
+        if (d == AIInput::EASY)
+            runEasy(begin, end);
+        else if (d == AIInput::MEDIUM)
+            runMedium(begin, end);
+        else
+            runHard(state, begin, end);
+        begin = end;
+    }
+
+    decide();
+
+    for (unsigned int k = 0; k < begin; k++)
+        inputs[players[k]] = (int)changes[k];
+    // INSANE's rollouts are already spread over threads, and cost far
+    // more than anything here, so its bots just run one at a time.
+    for (unsigned int k = begin; k < bots.size(); k++)
+        inputs[players[k]] = bots[k].update(state, players[k]);
+#endif
+}
+
+#ifdef PING_AI_BATCH_SIMD
+// Finds each bot's paddle midpoint and chooses its ball, as
+// AIInput::update() and AIInput::chooseBall() do, and then gathers
+// that ball's position and velocity.
+void AIBatch::gather(const SharedState &state) {
+    const EntityStore &paddles = state.players, &balls = state.balls;
+    unsigned int numBalls = balls.size();
+    centerX.resize(numBalls);
+    centerY.resize(numBalls);
+    velocityX.resize(numBalls);
+    velocityY.resize(numBalls);
+    for (unsigned int b = 0; b < numBalls; b++) {
+        Vector2 center = balls.getCenter(b);
+        centerX[b] = center.x;
+        centerY[b] = center.y;
+        velocityX[b] = balls.getDX(b);
+        velocityY[b] = balls.getDY(b);
+    }
+
+    for (unsigned int k = 0; k < bots.size(); k++) {
+        int p = players[k];
+        paddleX[k] = paddles.x[p];
+        paddleY[k] = paddles.y[p];
+        halfW[k] = paddles.w[p]/2;
+        halfH[k] = paddles.h[p]/2;
+        paddleW[k] = paddles.w[p];
+        paddleH[k] = paddles.h[p];
+        cosOrientation[k] = paddles.cosOrientation[p];
+        sinOrientation[k] = paddles.sinOrientation[p];
+        dirX[k] = paddles.cosTheta[p];
+        dirY[k] = paddles.sinTheta[p];
+        paddleV[k] = paddles.v[p];
+    }
+
+    // The midpoint of vertices 1 and 2 of EntityStore::getVertices().
+    const doublev two = broadcastv(2), zero = broadcastv(0);
+    const doublev arenaX = broadcastv(GameManager::WIDTH / 2.0), arenaY = broadcastv(state.centerY);
+    for (unsigned int i = 0; i < bots.size(); i += SIMD_WIDTH) {
+        doublev cx = loadv(&paddleX[i]) + loadv(&halfW[i]), cy = loadv(&paddleY[i]) + loadv(&halfH[i]);
+        doublev w = loadv(&paddleW[i]), h = loadv(&paddleH[i]);
+        doublev co = loadv(&cosOrientation[i]), so = loadv(&sinOrientation[i]);
+        doublev mx = (cx + co * w / two + so * h / two + (cx + co * w / two - so * h / two)) / two;
+        doublev my = (cy + so * w / two - co * h / two + (cy + so * w / two + co * h / two)) / two;
+        storev(&midX[i], mx);
+        storev(&midY[i], my);
+
+        doublev best = zero;
+        if (numBalls > 1) {
+            doublev outX = mx - arenaX, outY = my - arenaY;
+            doublev bestDist = broadcastv(1.0 / 0.0);
+            longv bestApproaching = {};
+            for (unsigned int b = 0; b < numBalls; b++) {
+                longv approaching = broadcastv(velocityX[b]) * outX + broadcastv(velocityY[b]) * outY > zero;
+                doublev dx = broadcastv(centerX[b]) - mx, dy = broadcastv(centerY[b]) - my;
+                doublev dist = dx * dx + dy * dy;
+                longv better = (approaching & ~bestApproaching) | (~(approaching ^ bestApproaching) & (dist < bestDist));
+                best = better ? broadcastv(b) : best;
+                bestApproaching = better ? approaching : bestApproaching;
+                bestDist = better ? dist : bestDist;
+            }
+        }
+        storev(&chosen[i], best);
+    }
+
+    for (unsigned int k = 0; k < bots.size(); k++) {
+        int b = ballNums[k] = (int)chosen[k];
+        ballX[k] = centerX[b];
+        ballY[k] = centerY[b];
+        ballDX[k] = velocityX[b];
+        ballDY[k] = velocityY[b];
+        cornerX[k] = balls.x[b];
+        cornerY[k] = balls.y[b];
+    }
+}
+
+// The kernels below do the same operations as AIInput::update(), in
+// the same order, so that the results are identical.
+
+void AIBatch::runEasy(unsigned int begin, unsigned int end) {
+    for (unsigned int i = begin; i < end; i += SIMD_WIDTH) {
+        doublev dx = loadv(&dirX[i]), dy = loadv(&dirY[i]);
+        storev(&predicted[i], loadv(&ballX[i]) * dx + loadv(&ballY[i]) * dy);
+        storev(&time[i], broadcastv(.1));
+    }
+}
+
+void AIBatch::runMedium(unsigned int begin, unsigned int end) {
+    const doublev zero = broadcastv(0);
+    for (unsigned int i = begin; i < end; i += SIMD_WIDTH) {
+        doublev mx = loadv(&midX[i]), my = loadv(&midY[i]);
+        doublev dx = loadv(&dirX[i]), dy = loadv(&dirY[i]);
+        doublev vx = loadv(&ballDX[i]), vy = loadv(&ballDY[i]);
+
+        doublev speed = sqrtv(vx * vx + vy * vy);
+        doublev ux = speed == 0 ? zero : vx / speed;
+        doublev uy = speed == 0 ? zero : vy / speed;
+        doublev cross = dx * uy - dy * ux;
+
+        doublev along = ((loadv(&ballX[i]) - mx) * uy - (loadv(&ballY[i]) - my) * ux) / cross;
+        doublev px = mx + dx * along, py = my + dy * along;
+        doublev ex = px - loadv(&cornerX[i]), ey = py - loadv(&cornerY[i]);
+
+        storev(&predicted[i], cross != 0 ? px * dx + py * dy : mx * dx + my * dy);
+        storev(&time[i], cross != 0 ? sqrtv(ex * ex + ey * ey) / speed : broadcastv(1.0 / 60));
+    }
+}
+
+// Predictions are cached per bot, as in AIInput, and only remade
+// (one bot at a time) when they've gone stale.
+void AIBatch::runHard(const SharedState &state, unsigned int begin, unsigned int end) {
+    for (unsigned int k = begin; k < end; k++) {
+        startX[k] = bots[k].prediction.start.x;
+        startY[k] = bots[k].prediction.start.y;
+    }
+
+    for (unsigned int i = begin; i < end; i += SIMD_WIDTH) {
+        doublev ex = loadv(&ballX[i]) - loadv(&startX[i]), ey = loadv(&ballY[i]) - loadv(&startY[i]);
+        doublev vx = loadv(&ballDX[i]), vy = loadv(&ballDY[i]);
+        storev(&elapsed[i], sqrtv(ex * ex + ey * ey) / sqrtv(vx * vx + vy * vy));
+    }
+
+    for (unsigned int k = begin; k < end; k++) {
+        AIInput::Prediction &prediction = bots[k].prediction;
+        if (bots[k].isStale(state, players[k], ballNums[k], elapsed[k])) {
+            prediction = AIInput::predict(state, players[k], ballNums[k]);
+            elapsed[k] = 0;
+        }
+        found[k] = prediction.found;
+        interceptX[k] = prediction.intercept.x;
+        interceptY[k] = prediction.intercept.y;
+        predictionTime[k] = prediction.time;
+    }
+
+    for (unsigned int i = begin; i < end; i += SIMD_WIDTH) {
+        doublev mx = loadv(&midX[i]), my = loadv(&midY[i]);
+        doublev dx = loadv(&dirX[i]), dy = loadv(&dirY[i]);
+        longv hit = loadv(&found[i]) != 0;
+        storev(&predicted[i], hit ? loadv(&interceptX[i]) * dx + loadv(&interceptY[i]) * dy : mx * dx + my * dy);
+        storev(&time[i], hit ? loadv(&predictionTime[i]) - loadv(&elapsed[i]) : broadcastv(1.0 / 60));
+    }
+}
+
+void AIBatch::decide() {
+    const doublev deadZone = broadcastv(AIInput::DEAD_ZONE), zero = broadcastv(0);
+    for (unsigned int i = 0; i < bots.size(); i += SIMD_WIDTH) {
+        doublev position = loadv(&midX[i]) * loadv(&dirX[i]) + loadv(&midY[i]) * loadv(&dirY[i]);
+        doublev diff = (loadv(&predicted[i]) - position) / loadv(&time[i]) - loadv(&paddleV[i]);
+        storev(&changes[i], diff < -deadZone ? broadcastv(-1) : (diff > deadZone ? broadcastv(1) : zero));
+    }
+}
+#endif
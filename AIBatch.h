@@ -0,0 +1,49 @@
+// -*- c++ -*-
+#ifndef PING_AI_BATCH_H
+#define PING_AI_BATCH_H
+
+#include <vector>
+#include "AIInput.h"
+
+// Plays any number of paddles in one state with the AI, all at once:
+// each tick, everything the AI needs is gathered into one array per
+// quantity, and each difficulty's arithmetic runs over its bots a
+// vector at a time (see simd.h), rather than paddle by paddle through
+// PaddleInput. The results are exactly AIInput's (which the per-bot
+// state, and HARD's predictions, come from), so a bot can move between
+// the two without changing how it plays.
+class AIBatch {
+public:
+    // Adds a bot playing player (of the state given to update()).
+    void add(int player, AIInput::Difficulty difficulty);
+    void remove(int player);
+    void clear();
+    unsigned int size() const;
+
+    // Sets inputs[player] for every bot's player.
+    void update(SharedState &state, std::vector<int> &inputs);
+
+private:
+    // Kept sorted by difficulty, so that each difficulty's bots are a
+    // contiguous range.
+    std::vector<AIInput> bots;
+    std::vector<int> players;
+
+    // Per-tick scratch space, one entry per bot (plus a vector's worth
+    // of padding at the end)...
+    std::vector<int> ballNums;
+    std::vector<double> paddleX, paddleY, halfW, halfH, paddleW, paddleH, cosOrientation, sinOrientation, chosen;
+    std::vector<double> midX, midY, dirX, dirY, ballX, ballY, ballDX, ballDY, cornerX, cornerY, paddleV;
+    std::vector<double> startX, startY, elapsed, found, interceptX, interceptY, predictionTime;
+    std::vector<double> predicted, time, changes;
+    // ...and one per ball.
+    std::vector<double> centerX, centerY, velocityX, velocityY;
+
+    void gather(const SharedState &state);
+    void runEasy(unsigned int begin, unsigned int end);
+    void runMedium(unsigned int begin, unsigned int end);
+    void runHard(const SharedState &state, unsigned int begin, unsigned int end);
+    void decide();
+};
+
+#endif
@@ -3,96 +3,136 @@
 #include "GameManager.h"
 #include "utility.h"
 
-const char *AIInput::DIFFICULTY_STRS[] = { "Easy", "Medium", "Hard" };
+const char *AIInput::DIFFICULTY_STRS[] = { "Easy", "Medium", "Hard", "Insane" };
+
+// Times are in seconds and speeds in pixels per second, like the
+// state's. The paddle is only pushed if it's off the speed it needs by
+// more than DEAD_ZONE.
+const double AIInput::DEAD_ZONE = 60;
+// How far a ball can turn before HARD's prediction of it is redone.
+const double AIInput::SPIN_TOLERANCE = pi / 8;
+
+// planner is RolloutPlanner() by default (see AIInput.h).
+AIInput::AIInput(Difficulty difficulty, const RolloutPlanner &planner): difficulty(difficulty), planner(planner) {
+    prediction.ball = -1;
+}
+
+double AIInput::getHelperSeconds() const {
+    return planner.helperSeconds;
+}
+
+// Picks the ball to play: the closest one that's heading towards this
+// paddle's side of the arena, or just the closest one if none are.
+int AIInput::chooseBall(const SharedState &state, const Vector2 &playerMid) {
+    if (state.balls.size() == 1)
+        return 0;
+
+    Vector2 outward = playerMid - Vector2(GameManager::WIDTH / 2.0, state.centerY);
+    int best = 0;
+    bool bestApproaching = false;
+    double bestDist = 1.0 / 0.0;
+
+    for (unsigned int i = 0; i < state.balls.size(); i++) {
+        bool approaching = Vector2(state.balls.getDX(i), state.balls.getDY(i)) * outward > 0;
+        double dist = (state.balls.getCenter(i) - playerMid).sqrLength();
+        if ((approaching && !bestApproaching) || (approaching == bestApproaching && dist < bestDist)) {
+            best = i;
+            bestApproaching = approaching;
+            bestDist = dist;
+        }
+    }
+
+    return best;
+}
+
+// Works out where the ball (as it is now) will cross the line 40
+// pixels (scaled) in front of the paddle's edge.
+AIInput::Prediction AIInput::predict(const SharedState &state, int playerNum, int ballNum) {
+    Prediction prediction;
+    prediction.ball = ballNum;
+    prediction.player = playerNum;
+    prediction.trajectory = state.ballTrajectories[ballNum];
+    prediction.start = state.balls.getCenter(ballNum);
+    prediction.orientation = state.balls.orientation[ballNum];
+    prediction.found = state.traceBall(ballNum, playerNum, 40 * state.scale, prediction.intercept, prediction.time);
+    return prediction;
+}
+
+// Between changes to its trajectory the ball goes in a straight line at
+// a steady speed, so the time left is just the prediction's less the
+// time it's taken to get here (elapsed). Once that runs out, the ball
+// is past the intercept, and where it goes next has to be worked out
+// again. Which of its corners reaches each wall depends on how the ball
+// is turned, so a spinning ball is also looked at again every
+// SPIN_TOLERANCE radians.
+bool AIInput::isStale(const SharedState &state, int playerNum, int ballNum, double elapsed) const {
+    return prediction.ball != ballNum || prediction.player != playerNum ||
+        prediction.trajectory != state.ballTrajectories[ballNum] ||
+        (prediction.found && elapsed >= prediction.time) ||
+        fabs(state.balls.orientation[ballNum] - prediction.orientation) > SPIN_TOLERANCE;
+}
 
-AIInput::AIInput(Difficulty difficulty): difficulty(difficulty) {}
+// Redoes the prediction for ball ballNum if it's stale, and returns how
+// long (in seconds) the ball has been going since it was made.
+double AIInput::track(const SharedState &state, int playerNum, int ballNum) {
+    double dx = state.balls.getDX(ballNum), dy = state.balls.getDY(ballNum);
+    double elapsed = (state.balls.getCenter(ballNum) - prediction.start).length() / sqrt(dx*dx + dy*dy);
+    if (isStale(state, playerNum, ballNum, elapsed)) {
+        prediction = predict(state, playerNum, ballNum);
+        elapsed = 0;
+    }
+    return elapsed;
+}
 
 int AIInput::update(SharedState &state, int playerNum) {
-    Entity &player = state.players[playerNum];
-    Vector2 dir(cos(player.theta), sin(player.theta));
-    Vector2 playerMid((player.getVertices()[1] + player.getVertices()[2]) / 2);
-    Vector2 ballMid(state.ball.getCenter());
+    Vector2 dir(state.players.cosTheta[playerNum], state.players.sinTheta[playerNum]);
+    Vector2 vertices[4];
+    state.players.getVertices(playerNum, vertices);
+    Vector2 playerMid((vertices[1] + vertices[2]) / 2);
+    int ballNum = chooseBall(state, playerMid);
+    const Entity target = state.balls[ballNum];
+    Vector2 ballMid(target.getCenter());
     double playerPos = playerMid * dir;
     double predictedPos, time;
 
     if (difficulty == EASY) {
         predictedPos = ballMid * dir;
-        time = 6;
+        time = .1;
     } else if (difficulty == MEDIUM) {
-        Vector2 ballDir(cos(state.ball.theta), sin(state.ball.theta));
+        Vector2 ballDir = Vector2(target.dx, target.dy).unit();
         if (dir.cross(ballDir) != 0) {
             Vector2 ballPos = playerMid + dir * ((ballMid - playerMid).cross(ballDir) / dir.cross(ballDir));
             predictedPos = ballPos * dir;
-            time = (ballPos - Vector2(state.ball.x, state.ball.y)).length() / state.ball.v;
+            time = (ballPos - Vector2(target.x, target.y)).length() / target.getV();
         } else {
             predictedPos = playerPos;
-            time = 1;
+            time = 1.0 / 60;
         }
-    } else if (difficulty == HARD) {
-        Entity ball(state.ball);
-        bool found = false;
-        int targetBoundary = state.playerToBoundaryIndex(playerNum);
-        time = 0;
-
-        // Simulate 50 bounces, max.
-        for (int c = 0; !found && c < 50; c++) {
+    } else {
+        // INSANE starts from HARD's move, and only plans (see
+        // RolloutPlanner) once the ball's on its way.
+        double elapsed = track(state, playerNum, ballNum);
+        if (prediction.found) {
+            predictedPos = prediction.intercept * dir;
+            time = prediction.time - elapsed;
+        } else {
             predictedPos = playerPos;
-
-            std::vector<Vector2> qs = ball.getVertices();
-            Vector2 s(cos(ball.theta), sin(ball.theta));
-
-            int minVertex = -1;
-            int minBoundary = -1;
-            double min = 1.0 / 0.0;
-            
-            for (unsigned int i = 0; i < state.boundaries.size(); i++) {
-                Vector2 p = state.boundaries[(state.boundaries.size()+(int)i-1)%state.boundaries.size()];
-                Vector2 r = state.boundaries[i] - p;
-                if (state.boundaryToPlayerIndex(i) != -1)
-                    p += 40 * state.scale * Vector2(-r.unit().y, r.unit().x);
-
-
-                if (r.cross(s) == 0)
-                    continue;
-
-                for (int v = 0; v < 4; v++) {
-                    double t = (qs[v] - p).cross(s) / r.cross(s);
-                    double u = (qs[v] - p).cross(r) / r.cross(s);
-                    if (t >= 0 && t <= 1 && u > 0 && u < min) {
-                        minVertex = v;
-                        minBoundary = i;
-                        min = u;
-                    }
-                }
-            }
-
-            if (minVertex == -1)
-                break;
-
-            Vector2 r(state.boundaries[minBoundary] - state.boundaries[(state.boundaries.size()+minBoundary-1)%state.boundaries.size()]);
-            
-            time += min / ball.v;
-            Vector2 bounce = qs[minVertex] + min * s;
-            ball.setCenter(ball.getCenter() - qs[minVertex] + bounce);
-            ball.theta = 2*atan2(r.y, r.x) - ball.theta;
-            
-            if (minBoundary == targetBoundary) {
-                found = true;
-                predictedPos = ball.getCenter() * dir;
-                break;
-            }
+            time = 1.0 / 60;
         }
     }
 
     double requiredV = (predictedPos - playerPos) / time;
-    double diff = requiredV - player.v;
+    double diff = requiredV - state.players.v[playerNum];
 
     int change = 0;
-    if (diff < -1)
+    if (diff < -DEAD_ZONE)
         change = -1;
-    else if (diff > 1)
+    else if (diff > DEAD_ZONE)
         change = 1;
 
+    if (difficulty == INSANE && prediction.found && time < RolloutPlanner::HORIZON)
+        change = planner.plan(state, playerNum, ballNum, change);
+
     return change;
 
     /*
@@ -3,16 +3,47 @@
 #define PING_AI_INPUT_H
 
 #include "PaddleInput.h"
+#include "RolloutPlanner.h"
+#include "Vector2.h"
 
 class AIInput: public PaddleInput {
 public:
-    enum Difficulty { EASY, MEDIUM, HARD, NUM_DIFFICULTY };
+    enum Difficulty { EASY, MEDIUM, HARD, INSANE, NUM_DIFFICULTY };
     static const char *DIFFICULTY_STRS[];
 
     Difficulty difficulty;
 
-    AIInput(Difficulty difficulty);
+    // planner is only used by INSANE.
+    AIInput(Difficulty difficulty, const RolloutPlanner &planner=RolloutPlanner());
     int update(SharedState &state, int playerNum);
+    // See RolloutPlanner::helperSeconds.
+    double getHelperSeconds() const;
+
+private:
+    friend class AIBatch;
+    friend class LearnedInput;
+
+    static const double DEAD_ZONE, SPIN_TOLERANCE;
+
+    // HARD's last prediction: where the ball (starting from start,
+    // turned to orientation) will cross the paddle's edge and how long
+    // it'll take (if found is set). It stands until the ball's
+    // trajectory changes (see SharedState::ballTrajectories), or the
+    // ball spins too far.
+    struct Prediction {
+        int ball, player;
+        unsigned long trajectory;
+        bool found;
+        Vector2 start, intercept;
+        double orientation, time;
+    };
+    Prediction prediction;
+    RolloutPlanner planner;
+
+    static int chooseBall(const SharedState &state, const Vector2 &playerMid);
+    static Prediction predict(const SharedState &state, int playerNum, int ballNum);
+    bool isStale(const SharedState &state, int playerNum, int ballNum, double elapsed) const;
+    double track(const SharedState &state, int playerNum, int ballNum);
 };
 
 #endif
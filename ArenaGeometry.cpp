@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <math.h>
+#include "ArenaGeometry.h"
+
+ArenaGeometry::ArenaGeometry(const std::vector<Vector2> &boundaries, int numPlayers, int playerBoundaryOffset) {
+    unsigned int n = boundaries.size();
+    int wallMult = n / numPlayers;
+
+    starts.resize(n);
+    edges.resize(n);
+    normals.resize(n);
+    offsets.resize(n);
+    angles.resize(n);
+    owners.resize(n);
+    playerEdges.resize(numPlayers);
+
+    for (unsigned int i = 0; i < n; i++) {
+        starts[i] = boundaries[(n+i-1)%n];
+        edges[i] = boundaries[i] - starts[i];
+        Vector2 dir = edges[i].unit();
+        normals[i] = Vector2(-dir.y, dir.x);
+        offsets[i] = normals[i] * starts[i];
+        angles[i] = atan2(edges[i].y, edges[i].x);
+        center += boundaries[i] / n;
+
+        int val = (n + i - playerBoundaryOffset) % n;
+        if ((val % wallMult) != 0) {
+            owners[i] = -1;
+            walls.push_back(i);
+        } else {
+            owners[i] = val / wallMult;
+        }
+    }
+
+    for (int p = 0; p < numPlayers; p++)
+        playerEdges[p] = (playerBoundaryOffset + wallMult * p) % n;
+
+    rectangle = n == 4;
+    for (unsigned int i = 0; rectangle && i < n; i++)
+        rectangle = fabs(normals[i] * normals[(i+1)%n]) < 0.0000000001;
+
+    // Inward normals 120 degrees apart.
+    triangle = n == 3;
+    for (unsigned int i = 0; triangle && i < n; i++)
+        triangle = fabs(normals[i] * normals[(i+1)%n] + 0.5) < 0.0000000001;
+
+    // The corner opposite edge c is where the other two lines meet; as
+    // they're moved in, it moves by a fixed amount per unit each.
+    for (unsigned int c = 0; triangle && c < n; c++) {
+        const Vector2 &a = normals[(c+1)%n], &b = normals[(c+2)%n];
+        double det = a.x * b.y - a.y * b.x;
+        cornerSteps[c][0] = Vector2(b.y / det, -b.x / det);
+        cornerSteps[c][1] = Vector2(-a.y / det, a.x / det);
+    }
+}
+
+double ArenaGeometry::getInset(int i, const Vector2 corners[4], double goalInset) const {
+    // The corner furthest out along the edge's normal touches first.
+    double inset = owners[i] != -1 ? goalInset : 0;
+    double support = -(corners[0] * normals[i]);
+    for (int v = 1; v < 4; v++)
+        support = std::max(support, (double)-(corners[v] * normals[i]));
+    return inset + support;
+}
+
+bool ArenaGeometry::trace(const Vector2 &p, const Vector2 &dir, const Vector2 corners[4], double goalInset, int target, int maxBounces,
+                          Vector2 &hit, double &distance) const {
+    if (triangle)
+        return traceTriangle(p, dir, corners, goalInset, target, maxBounces, hit, distance);
+    if (!rectangle)
+        return traceReflected(p, dir, corners, goalInset, target, maxBounces, hit, distance);
+
+    // x runs from the target's line (lo) to the opposite one (hi), and
+    // y between the other two. Unfolded, the body moves in a straight
+    // line across copies of the arena mirrored at each line, meeting
+    // the target's line in one of them, and each line crossed on the
+    // way is a bounce.
+    int opposite = (target + 2) % 4, side = (target + 1) % 4, otherSide = (target + 3) % 4;
+    const Vector2 &xAxis = normals[target], &yAxis = normals[side];
+    double lo = offsets[target] + getInset(target, corners, goalInset);
+    double hi = -(offsets[opposite] + getInset(opposite, corners, goalInset));
+    double yLo = offsets[side] + getInset(side, corners, goalInset);
+    double yHi = -(offsets[otherSide] + getInset(otherSide, corners, goalInset));
+    double x = p * xAxis, y = p * yAxis;
+
+    // Bodies that start outside the lines (or too big to fit between
+    // them) are left to the general case.
+    if (x < lo || x > hi || y < yLo || y > yHi)
+        return traceReflected(p, dir, corners, goalInset, target, maxBounces, hit, distance);
+
+    double dx = dir * xAxis, dy = dir * yAxis;
+    if (dx == 0)
+        return false;
+
+    int bounces = 0;
+    if (dx < 0) {
+        distance = (x - lo) / -dx;
+    } else {
+        distance = (2*hi - x - lo) / dx;
+        bounces++;
+    }
+
+    double width = yHi - yLo;
+    double unfolded = (y + dy * distance - yLo) / width;
+    double copy = floor(unfolded);
+    double along = unfolded - copy;
+    bounces += (int)fabs(copy);
+    if (bounces > maxBounces)
+        return false;
+
+    // Every other copy is mirrored.
+    double foldedY = yLo + width * (fmod(fabs(copy), 2) == 0 ? along : 1 - along);
+    hit = lo * xAxis + foldedY * yAxis;
+    return true;
+}
+
+// The inset lines still make an equilateral triangle (moving its lines
+// doesn't change its angles), of height h. With d[i] the distance in
+// from line i, d[0] + d[1] + d[2] = h everywhere (the normals sum to
+// zero), and mirrored copies of the triangle tile the plane along the
+// lines d[i] = m*h, for every whole m. Unlike the rectangle's, those
+// lines aren't copies of one edge all along: each stretch between two
+// vertices of the tiling is a copy of the edge joining the corners those
+// vertices fold back onto, which changes from stretch to stretch. So
+// the unfolded path is followed from crossing to crossing, but each
+// takes a few multiply-adds, rather than a search of every edge and a
+// reflection.
+bool ArenaGeometry::traceTriangle(const Vector2 &p, const Vector2 &dir, const Vector2 corners[4], double goalInset, int target,
+                                  int maxBounces, Vector2 &hit, double &distance) const {
+    double lines[3], d[3], rates[3], h = 0;
+    for (int i = 0; i < 3; i++) {
+        lines[i] = offsets[i] + getInset(i, corners, goalInset);
+        d[i] = p * normals[i] - lines[i];
+        rates[i] = dir * normals[i];
+        h -= lines[i];
+    }
+
+    // Bodies that start outside the lines (or too big to fit between
+    // them) are left to the general case.
+    if (h <= 0 || d[0] < 0 || d[1] < 0 || d[2] < 0)
+        return traceReflected(p, dir, corners, goalInset, target, maxBounces, hit, distance);
+
+    // The next line crossed in each direction (as a multiple of h), and
+    // how far along the path it is.
+    int next[3], steps[3];
+    double at[3];
+    for (int i = 0; i < 3; i++) {
+        steps[i] = rates[i] > 0 ? 1 : -1;
+        next[i] = rates[i] > 0 ? 1 : 0;
+        at[i] = rates[i] != 0 ? (next[i] * h - d[i]) / rates[i] : INFINITY;
+    }
+
+    // A tiling vertex is where d is h times (k[0], k[1], k[2]), and the
+    // original triangle's corner opposite edge c has k[c] = 1, so that
+    // (k[1] + 2*k[2]) mod 3 is the corner each one folds back onto.
+    // Crossing line f at d[f] = m*h, where a*h <= d[f+1] < (a+1)*h, is
+    // then crossing a copy of edge (m + 2*a + f) mod 3, which runs from
+    // the corner numbered one below it (at a) to the one above (at a+1).
+    for (int bounces = 0; ; bounces++) {
+        int f = at[0] <= at[1] && at[0] <= at[2] ? 0 : (at[1] <= at[2] ? 1 : 2);
+        if (at[f] == INFINITY)
+            return false;
+
+        int j = (f + 1) % 3;
+        double along = (d[j] + rates[j] * at[f]) / h;
+        int a = (int)floor(along);
+        int edge = (next[f] + 2*a + f) % 3;
+        if (edge < 0)
+            edge += 3;
+
+        if (edge == target) {
+            int from = (target + 2) % 3, to = (target + 1) % 3;
+            Vector2 fromCorner = lines[target] * cornerSteps[from][0] + lines[to] * cornerSteps[from][1];
+            Vector2 toCorner = lines[from] * cornerSteps[to][0] + lines[target] * cornerSteps[to][1];
+            hit = fromCorner + (along - a) * (toCorner - fromCorner);
+            distance = at[f];
+            return true;
+        }
+        if (bounces == maxBounces)
+            return false;
+
+        next[f] += steps[f];
+        at[f] = (next[f] * h - d[f]) / rates[f];
+    }
+}
+
+bool ArenaGeometry::traceReflected(Vector2 p, Vector2 dir, const Vector2 corners[4], double goalInset, int target, int maxBounces,
+                                   Vector2 &hit, double &distance) const {
+    distance = 0;
+
+    // The arena is convex, so the body leaves it through whichever
+    // line it reaches first. A body already past a line it's heading
+    // out of reaches it straight away.
+    for (int bounces = 0; ; bounces++) {
+        int exit = -1;
+        double best = INFINITY;
+        for (unsigned int i = 0; i < normals.size(); i++) {
+            double approach = -(dir * normals[i]);
+            if (approach <= 0)
+                continue;
+            double t = std::max(0.0, (p * normals[i] - offsets[i] - getInset(i, corners, goalInset)) / approach);
+            if (t < best) {
+                best = t;
+                exit = i;
+            }
+        }
+
+        if (exit == -1)
+            return false;
+
+        p += best * dir;
+        distance += best;
+        if (exit == target) {
+            hit = p;
+            return true;
+        }
+        if (bounces == maxBounces)
+            return false;
+        dir -= 2 * (dir * normals[exit]) * normals[exit];
+    }
+}
@@ -0,0 +1,62 @@
+// -*- c++ -*-
+#ifndef PING_ARENA_GEOMETRY_H
+#define PING_ARENA_GEOMETRY_H
+
+#include <vector>
+#include "Vector2.h"
+
+// Everything about the arena's shape that only changes when it's
+// reset, worked out once so that the simulation, the AI and the
+// renderer don't each have to redo it. Edge i runs from boundary i-1 to
+// boundary i, matching SharedState::boundaries.
+class ArenaGeometry {
+public:
+    // edges[i] is the (non-unit) vector from starts[i] to the edge's end.
+    std::vector<Vector2> starts, edges;
+    // Unit normals pointing into the arena; a point p is inside edge
+    // i's half-plane when normals[i] * p > offsets[i].
+    std::vector<Vector2> normals;
+    std::vector<double> offsets;
+    // The angle of each edge, which the dashes drawn out from the
+    // corners are turned by.
+    std::vector<double> angles;
+    // The player whose goal each edge is (or -1 for plain walls), and
+    // each player's edge.
+    std::vector<int> owners, playerEdges;
+    // The plain walls' edge indices, in order.
+    std::vector<int> walls;
+    Vector2 center;
+
+    ArenaGeometry(const std::vector<Vector2> &boundaries, int numPlayers, int playerBoundaryOffset);
+
+    // Follows a body (with corners at the given offsets from its
+    // center) from p in the direction dir (a unit vector), bouncing off
+    // every edge but target, with the goals' edges moved goalInset into
+    // the arena. Returns false if it won't reach target within
+    // maxBounces bounces; otherwise, sets hit to where its center will
+    // be as it touches target, and distance to how far it'll have gone.
+    // Rectangles and equilateral triangles (classic, 4x1 and 3x1) are
+    // unfolded, mirrored at their edges so that the path is a straight
+    // line through the copies; rectangles are then solved directly, and
+    // triangles step from crossing to crossing. Other polygons aren't
+    // sped up: they go bounce by bounce with traceReflected().
+    bool trace(const Vector2 &p, const Vector2 &dir, const Vector2 corners[4], double goalInset, int target, int maxBounces,
+               Vector2 &hit, double &distance) const;
+    bool traceReflected(Vector2 p, Vector2 dir, const Vector2 corners[4], double goalInset, int target, int maxBounces,
+                        Vector2 &hit, double &distance) const;
+
+private:
+    // Whether the edges form a rectangle (as in classic mode) or an
+    // equilateral triangle, so that trace() can unfold them.
+    bool rectangle, triangle;
+    // For triangles, how far the corner opposite edge c moves as each
+    // of the other two edges' lines (c+1 and c+2) moves in by one.
+    Vector2 cornerSteps[3][2];
+    // How far into the arena edge i's line is when tracing a body with
+    // the given corners.
+    double getInset(int i, const Vector2 corners[4], double goalInset) const;
+    bool traceTriangle(const Vector2 &p, const Vector2 &dir, const Vector2 corners[4], double goalInset, int target, int maxBounces,
+                       Vector2 &hit, double &distance) const;
+};
+
+#endif
@@ -0,0 +1,605 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "SharedState.h"
+#include "AIInput.h"
+#include "AIBatch.h"
+#include "LearnedInput.h"
+#include "utility.h"
+
+// Micro-benchmarks for the simulation; see usage() for the list.
+
+typedef std::chrono::steady_clock Clock;
+
+// Results that would otherwise be unused go here, so that the work
+// producing them isn't optimized away.
+static volatile int sink;
+
+static double nsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// The update() benchmarks run at the physics rate, so that each tick is
+// exactly one step.
+
+// Times SharedState::update() in a 4-player arena with 1 to 256 balls
+// (and idle paddles, so that the balls are all that changes).
+static void benchBalls(int ticks) {
+    std::cout << "balls\tns/tick\tns/ball" << std::endl;
+    for (int numBalls = 1; numBalls <= 256; numBalls *= 2) {
+        SharedState state;
+        state.seed(1);
+        state.reset(4, 1, numBalls);
+        state.setTickRate(SharedState::PHYSICS_RATE);
+        std::vector<int> inputs(state.players.size(), 0);
+
+        for (int t = 0; t < ticks / 10; t++)
+            state.update(inputs);
+
+        Clock::time_point start = Clock::now();
+        for (int t = 0; t < ticks; t++)
+            state.update(inputs);
+        double perTick = nsSince(start) / ticks;
+
+        std::cout << numBalls << "\t" << std::fixed << std::setprecision(0) << perTick << "\t"
+                  << perTick / numBalls << std::endl;
+    }
+}
+
+// Compares SharedState::update() with and without the broadphase in
+// arenas of 2 to 1024 paddles, with 16 balls in play.
+static void benchBroadphase(int ticks) {
+    std::cout << "paddles\tbrute ns/tick\tgrid ns/tick" << std::endl;
+    for (int numPlayers = 2; numPlayers <= 1024; numPlayers *= 8) {
+        double perTick[2];
+        for (int mode = 0; mode < 2; mode++) {
+            SharedState state;
+            state.seed(1);
+            state.reset(numPlayers, numPlayers > 2 ? 1 : 2, 16);
+            state.setTickRate(SharedState::PHYSICS_RATE);
+            state.broadphase = mode == 1;
+            std::vector<int> inputs(state.players.size(), 0);
+
+            Clock::time_point start = Clock::now();
+            for (int t = 0; t < ticks; t++)
+                state.update(inputs);
+            perTick[mode] = nsSince(start) / ticks;
+        }
+
+        std::cout << numPlayers << "\t" << std::fixed << std::setprecision(0)
+                  << perTick[0] << "\t" << perTick[1] << std::endl;
+    }
+}
+
+// Times AIInput::update() for each difficulty (and LearnedInput, with
+// and without its features), over the states of a
+// 4-player, 4-ball game played by the AI (each state being new to the
+// AI, so HARD predicts from scratch every time), and then splits the
+// time of a 16-player game played by HARD AIs at the default tick rate
+// (where HARD mostly reuses its predictions) between them and update().
+static void benchAI(int ticks) {
+    std::vector<SharedState> states;
+    SharedState state;
+    state.seed(1);
+    state.reset(4, 2, 4);
+    std::vector<AIInput> players(4, AIInput(AIInput::HARD));
+    std::vector<int> inputs(4);
+    for (int t = 0; t < ticks; t++) {
+        for (int i = 0; i < 4; i++)
+            inputs[i] = players[i].update(state, i);
+        state.update(inputs);
+        if (t % 10 == 0)
+            states.push_back(state);
+    }
+
+    std::cout << "difficulty\tns/update" << std::endl;
+    for (int d = 0; d < AIInput::NUM_DIFFICULTY; d++) {
+        AIInput ai((AIInput::Difficulty)d);
+        int total = 0;
+        Clock::time_point start = Clock::now();
+        for (SharedState &s : states) {
+            for (int i = 0; i < 4; i++)
+                total += ai.update(s, i);
+        }
+        double perUpdate = nsSince(start) / (states.size() * 4);
+        sink = total;
+        std::cout << AIInput::DIFFICULTY_STRS[d] << "\t\t" << std::fixed << std::setprecision(1) << perUpdate << std::endl;
+    }
+
+    // The model's weights don't affect its cost.
+    LearnedModel model;
+    std::minstd_rand rng(1);
+    model.randomize(rng, .5);
+    model.quantize(std::vector<LearnedModel::Features>());
+    LearnedInput learned(model);
+    std::vector<LearnedModel::Features> features;
+    int total = 0;
+    Clock::time_point start = Clock::now();
+    for (SharedState &s : states) {
+        for (int i = 0; i < 4; i++) {
+            features.push_back(learned.getFeatures(s, i));
+            total += model.play(features.back());
+        }
+    }
+    double perUpdate = nsSince(start) / features.size();
+    start = Clock::now();
+    for (const LearnedModel::Features &f : features)
+        total += model.play(f);
+    double perPlay = nsSince(start) / features.size();
+    sink = total;
+    std::cout << "Learned\t\t" << perUpdate << std::endl
+              << "(model only)\t" << perPlay << std::endl;
+
+    SharedState game;
+    game.seed(1);
+    game.reset(16, 1, 4);
+    std::vector<AIInput> ais(16, AIInput(AIInput::HARD));
+    std::vector<int> moves(16);
+    double aiNs = 0, updateNs = 0;
+    for (int t = 0; t < ticks; t++) {
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < 16; i++)
+            moves[i] = ais[i].update(game, i);
+        aiNs += nsSince(start);
+
+        start = Clock::now();
+        game.update(moves);
+        updateNs += nsSince(start);
+    }
+
+    std::cout << std::endl << "16 HARD AIs\tns/tick" << std::endl
+              << "AI\t\t" << std::setprecision(0) << aiNs / ticks << std::endl
+              << "update()\t" << updateNs / ticks << std::endl;
+}
+
+// Plays 64 rooms of 16 paddles (a mix of EASY to HARD, 4 balls) at the
+// default tick rate, with each room's bots run through both AIBatch and
+// their own AIInputs, timing the two. Returns false if they ever
+// disagree.
+static bool benchBatch(int ticks) {
+    const int ROOMS = 64, PLAYERS = 16;
+    std::vector<SharedState> rooms(ROOMS);
+    std::vector<AIBatch> batches(ROOMS);
+    std::vector<std::vector<AIInput>> ais(ROOMS);
+    for (int r = 0; r < ROOMS; r++) {
+        rooms[r].seed(r + 1);
+        rooms[r].reset(PLAYERS, 1, 4);
+        for (int i = 0; i < PLAYERS; i++) {
+            AIInput::Difficulty difficulty = (AIInput::Difficulty)((i + r) % (AIInput::HARD + 1));
+            batches[r].add(i, difficulty);
+            ais[r].push_back(AIInput(difficulty));
+        }
+    }
+
+    std::vector<int> inputs(PLAYERS), batchInputs(PLAYERS);
+    double aiNs = 0, batchNs = 0;
+    long long mismatches = 0;
+    for (int t = 0; t < ticks; t++) {
+        for (int r = 0; r < ROOMS; r++) {
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < PLAYERS; i++)
+                inputs[i] = ais[r][i].update(rooms[r], i);
+            aiNs += nsSince(start);
+
+            start = Clock::now();
+            batches[r].update(rooms[r], batchInputs);
+            batchNs += nsSince(start);
+
+            mismatches += inputs != batchInputs;
+            rooms[r].update(inputs);
+        }
+    }
+
+    double bots = (double)ticks * ROOMS * PLAYERS;
+    std::cout << "bots\tns/bot\tbots/core at " << SharedState::DEFAULT_TICK_RATE << " Hz" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << "AIInput\t" << aiNs / bots << "\t" << std::setprecision(0) << 1e9 / SharedState::DEFAULT_TICK_RATE / (aiNs / bots) << std::endl
+              << std::setprecision(1)
+              << "AIBatch\t" << batchNs / bots << "\t" << std::setprecision(0) << 1e9 / SharedState::DEFAULT_TICK_RATE / (batchNs / bots) << std::endl
+              << mismatches << " mismatched ticks" << std::endl;
+    return mismatches == 0;
+}
+
+static double randRange(double min, double max) {
+    return min + rand() / (double)RAND_MAX * (max - min);
+}
+
+// A random paddle- or ball-like entity somewhere near the middle of a
+// small area, so that about half of all pairs overlap.
+static Entity randomEntity() {
+    Entity entity((int)randRange(1, 80), (int)randRange(1, 80));
+    entity.x = randRange(0, 100);
+    entity.y = randRange(0, 100);
+    // Axis-aligned and right-angled boxes are common in play and have
+    // the most exact ties, so they're over-represented.
+    if (rand() % 4 == 0)
+        entity.setOrientation((rand() % 4) * pi/2);
+    else
+        entity.setOrientation(randRange(0, 2*pi));
+    return entity;
+}
+
+// Checks Entity::collide() against Entity::collideReference() on
+// random pairs (results must be identical, projections bit for bit),
+// then times both. Returns false if they ever disagree.
+static bool benchCollide(int pairs) {
+    srand(1);
+    std::vector<Entity> entities(2 * pairs);
+    for (Entity &entity : entities)
+        entity = randomEntity();
+
+    int mismatches = 0, collisions = 0;
+    for (int i = 0; i < pairs; i++) {
+        const Entity &a = entities[2*i], &b = entities[2*i + 1];
+        std::vector<Vector2> fast, reference;
+        bool hit = a.collide(b, &fast);
+        collisions += hit;
+        if (hit != a.collideReference(b, &reference) || fast.size() != reference.size() ||
+            memcmp(fast.data(), reference.data(), fast.size() * sizeof(Vector2)) != 0 ||
+            a.collide(b) != a.collideReference(b))
+            mismatches++;
+    }
+
+    std::cout << pairs << " pairs, " << collisions << " colliding, " << mismatches << " mismatches" << std::endl;
+
+    std::cout << "version	ns/test" << std::endl;
+    for (int mode = 0; mode < 2; mode++) {
+        std::vector<Vector2> projections;
+        int count = 0;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < pairs; i++) {
+            projections.clear();
+            if (mode == 0)
+                count += entities[2*i].collideReference(entities[2*i + 1], &projections);
+            else
+                count += entities[2*i].collide(entities[2*i + 1], &projections);
+        }
+        double perTest = nsSince(start) / pairs;
+        std::cout << (mode == 0 ? "scalar" : "simd") << "\t" << std::fixed << std::setprecision(1) << perTest
+                  << (count == collisions ? "" : " (wrong count)") << std::endl;
+    }
+
+    return mismatches == 0;
+}
+
+// The HARD AI's old predictor, kept for comparison: it follows the ball
+// bounce by bounce, testing each of its corners against every edge,
+// until it crosses player's goal line (moved goalInset into the arena).
+static bool traceByBounces(const SharedState &state, unsigned int b, int player, double goalInset, Vector2 &center, double &distance) {
+    const ArenaGeometry &arena = *state.geometry;
+    Entity ball(state.balls[b]);
+    int targetBoundary = arena.playerEdges[player];
+    Vector2 s = Vector2(ball.dx, ball.dy).unit();
+    distance = 0;
+
+    for (int c = 0; c <= 50; c++) {
+        Vector2 qs[4];
+        ball.getVertices(qs);
+
+        int minVertex = -1;
+        int minBoundary = -1;
+        double min = 1.0 / 0.0;
+
+        for (unsigned int i = 0; i < arena.edges.size(); i++) {
+            Vector2 p = arena.starts[i];
+            Vector2 r = arena.edges[i];
+            if (arena.owners[i] != -1)
+                p += goalInset * arena.normals[i];
+
+            if (r.cross(s) == 0)
+                continue;
+
+            for (int v = 0; v < 4; v++) {
+                double t = (qs[v] - p).cross(s) / r.cross(s);
+                double u = (qs[v] - p).cross(r) / r.cross(s);
+                if (t >= 0 && t <= 1 && u > 0 && u < min) {
+                    minVertex = v;
+                    minBoundary = i;
+                    min = u;
+                }
+            }
+        }
+
+        if (minVertex == -1)
+            return false;
+
+        distance += min;
+        Vector2 bounce = qs[minVertex] + min * s;
+        ball.setCenter(ball.getCenter() - qs[minVertex] + bounce);
+        s -= 2 * (s * arena.normals[minBoundary]) * arena.normals[minBoundary];
+
+        if (minBoundary == targetBoundary) {
+            center = ball.getCenter();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Times predicting where the ball will cross each goal line, over the
+// states of AI games in a few arenas: with the old bounce loop, with
+// ArenaGeometry::traceReflected(), and with ArenaGeometry::trace()
+// (which unfolds rectangles and triangles), the last two given the same
+// ball corners and direction. Returns false if SharedState::traceBall()
+// ever disagrees with traceReflected().
+static bool benchTrace(int ticks) {
+    struct Arena { const char *name; int players, walls; };
+    const Arena arenas[] = { { "classic", 2, 2 }, { "3x1", 3, 1 }, { "4x1", 4, 1 }, { "5x1", 5, 1 }, { "8x2", 8, 2 } };
+    int mismatches = 0;
+
+    std::cout << "arena\tloop ns\treflect ns\ttrace ns" << std::endl;
+    for (const Arena &arena : arenas) {
+        SharedState state;
+        state.seed(1);
+        if (strcmp(arena.name, "classic") == 0)
+            state.resetClassic();
+        else
+            state.reset(arena.players, arena.walls);
+
+        std::vector<SharedState> states;
+        std::vector<AIInput> ais(state.players.size(), AIInput(AIInput::HARD));
+        std::vector<int> inputs(state.players.size());
+        for (int t = 0; t < ticks; t++) {
+            for (unsigned int i = 0; i < ais.size(); i++)
+                inputs[i] = ais[i].update(state, i);
+            state.update(inputs);
+            if (t % 10 == 0)
+                states.push_back(state);
+        }
+
+        double goalInset = 40 * state.scale;
+        int queries = states.size() * state.players.size();
+        std::cout << arena.name;
+        for (int mode = 0; mode < 3; mode++) {
+            int found = 0;
+            Clock::time_point start = Clock::now();
+            for (const SharedState &s : states) {
+                Vector2 corners[4], center;
+                s.balls.getVertices(0, corners);
+                Vector2 ballMid = s.balls.getCenter(0);
+                for (Vector2 &corner : corners)
+                    corner -= ballMid;
+                Vector2 dir = Vector2(s.balls.getDX(0), s.balls.getDY(0)).unit();
+
+                for (unsigned int i = 0; i < s.players.size(); i++) {
+                    double distance;
+                    if (mode == 0)
+                        found += traceByBounces(s, 0, i, goalInset, center, distance);
+                    else if (mode == 1)
+                        found += s.geometry->traceReflected(ballMid, dir, corners, goalInset, s.geometry->playerEdges[i], 50, center, distance);
+                    else
+                        found += s.geometry->trace(ballMid, dir, corners, goalInset, s.geometry->playerEdges[i], 50, center, distance);
+                }
+            }
+            sink = found;
+            std::cout << "\t" << std::fixed << std::setprecision(1) << nsSince(start) / queries;
+        }
+        std::cout << std::endl;
+
+        for (const SharedState &s : states) {
+            Vector2 corners[4], ballMid = s.balls.getCenter(0);
+            s.balls.getVertices(0, corners);
+            for (Vector2 &corner : corners)
+                corner -= ballMid;
+            Vector2 dir = Vector2(s.balls.getDX(0), s.balls.getDY(0)).unit();
+            double speed = Vector2(s.balls.getDX(0), s.balls.getDY(0)).length();
+
+            for (unsigned int i = 0; i < s.players.size(); i++) {
+                Vector2 traced, reflected;
+                double time, distance;
+                bool a = s.traceBall(0, i, goalInset, traced, time);
+                bool b = s.geometry->traceReflected(ballMid, dir, corners, goalInset, s.geometry->playerEdges[i], 50, reflected, distance);
+                if (a != b || (a && ((traced - reflected).length() > 0.000001 || fabs(time * speed - distance) > 0.000001)))
+                    mismatches++;
+            }
+        }
+    }
+
+    std::cout << mismatches << " mismatches" << std::endl;
+    return mismatches == 0;
+}
+
+// The fuzzer's cost per tick is compared with the one stored in
+// FUZZ_BASELINE (for the same number of ticks), and fails if it's more
+// than FUZZ_TOLERANCE higher.
+static const char *FUZZ_BASELINE = "fuzz-baseline.txt";
+static const double FUZZ_TOLERANCE = .25;
+static const int FUZZ_TICKS_PER_CASE = 1000;
+
+// Describes the case being fuzzed, for when an assert fails.
+static char fuzzCase[256];
+
+static void onAbort(int signal) {
+    if (write(STDERR_FILENO, fuzzCase, strlen(fuzzCase)) < 0)
+        return;
+}
+
+// Runs one random arena (with paddles starting anywhere along their
+// edges, at any speed, and random held inputs) for
+// FUZZ_TICKS_PER_CASE ticks, checking the state after every one.
+// Returns the first problem found (or an empty string), adding the
+// time spent in update() to ns.
+static std::string runFuzzCase(unsigned int seed, long long &ticks, double &ns) {
+    std::minstd_rand rng(seed);
+    auto randInt = [&rng](int min, int max) { return std::uniform_int_distribution<int>(min, max)(rng); };
+    auto randReal = [&rng](double min, double max) { return std::uniform_real_distribution<double>(min, max)(rng); };
+
+    bool classic = randInt(0, 9) == 0;
+    int numPlayers = classic ? 2 : randInt(1, 12);
+    // Arenas need at least three edges to enclose anything.
+    int wallsPerPlayer = classic ? 2 : randInt((3 + numPlayers - 1) / numPlayers, 3);
+    int numBalls = randInt(1, 8);
+    snprintf(fuzzCase, sizeof(fuzzCase), "while fuzzing case %u: %d players, %d walls each%s, %d balls\n",
+             seed, numPlayers, wallsPerPlayer, classic ? " (classic)" : "", numBalls);
+
+    SharedState state;
+    state.seed(seed);
+    if (classic)
+        state.resetClassic(numBalls);
+    else
+        state.reset(numPlayers, wallsPerPlayer, numBalls);
+    state.setTickRate(SharedState::PHYSICS_RATE);
+
+    // Corners are where paddles meet, so a third of them start at one
+    // end or the other of their edges. A paddle that would start out
+    // overlapping a neighbor (which play can't lead to) stays centered.
+    const ArenaGeometry &arena = *state.geometry;
+    for (unsigned int i = 0; i < state.players.size(); i++) {
+        double range = std::max(0.0, (double)arena.edges[arena.playerEdges[i]].length() - state.players.h[i]) / 2;
+        double offset = randInt(0, 2) == 0 ? range * (randInt(0, 1) * 2 - 1) : randReal(-range, range);
+        Vector2 center = state.players.getCenter(i);
+        Vector2 moved = center + offset * Vector2(state.players.cosTheta[i], state.players.sinTheta[i]);
+        state.players.setCenter(i, moved.x, moved.y);
+        for (unsigned int o = 0; o < i; o++) {
+            if (state.players[i].collide(state.players[o]))
+                state.players.setCenter(i, center.x, center.y);
+        }
+        state.players.v[i] = randReal(-600, 600);
+    }
+
+    // About half of the paddles are played by the AI (EASY to HARD), which chases
+    // balls into corners (and so into its neighbors). The rest hold
+    // random inputs for up to a second; now and then
+    // that's more than one press, as a networked player's can be.
+    std::vector<AIInput> ais;
+    std::vector<bool> random;
+    for (unsigned int i = 0; i < state.players.size(); i++) {
+        ais.push_back(AIInput((AIInput::Difficulty)randInt(0, AIInput::HARD)));
+        random.push_back(randInt(0, 1) == 0);
+    }
+
+    std::vector<int> inputs(state.players.size()), held(state.players.size());
+    for (int t = 0; t < FUZZ_TICKS_PER_CASE; t++) {
+        for (unsigned int i = 0; i < inputs.size(); i++) {
+            if (!random[i]) {
+                inputs[i] = ais[i].update(state, i);
+            } else if (--held[i] <= 0) {
+                held[i] = randInt(1, SharedState::PHYSICS_RATE);
+                inputs[i] = randInt(0, 19) == 0 ? randInt(-3, 3) : randInt(-1, 1);
+            }
+        }
+
+        Clock::time_point start = Clock::now();
+        state.update(inputs);
+        ns += nsSince(start);
+        ticks++;
+
+        std::string problem = state.check();
+        if (!problem.empty()) {
+            std::ostringstream out;
+            out << "case " << seed << " (" << numPlayers << " players, " << wallsPerPlayer << " walls each"
+                << (classic ? ", classic" : "") << ", " << numBalls << " balls): tick " << t << ": " << problem;
+            return out.str();
+        }
+    }
+
+    return "";
+}
+
+// Fuzzes SharedState::update() with ticks' worth of random cases,
+// failing if any case breaks an invariant or if the cost per tick has
+// regressed from the baseline (or, if record is set, storing a new
+// baseline instead).
+static bool fuzz(int ticks, bool record) {
+    signal(SIGABRT, onAbort);
+
+    int cases = std::max(1, ticks / FUZZ_TICKS_PER_CASE), failures = 0;
+    long long totalTicks = 0;
+    double ns = 0;
+    for (int c = 1; c <= cases; c++) {
+        std::string problem = runFuzzCase(c, totalTicks, ns);
+        if (!problem.empty()) {
+            std::cout << problem << std::endl;
+            failures++;
+        }
+    }
+
+    double perTick = ns / totalTicks;
+    std::cout << cases << " cases, " << totalTicks << " ticks, " << failures << " failed invariant checks" << std::endl
+              << std::fixed << std::setprecision(0) << perTick << " ns/tick";
+
+    if (record) {
+        std::ofstream out(FUZZ_BASELINE);
+        out << ticks << " " << perTick << std::endl;
+        std::cout << " (stored in " << FUZZ_BASELINE << ")" << std::endl;
+        return failures == 0 && out.good();
+    }
+
+    std::ifstream in(FUZZ_BASELINE);
+    int baselineTicks;
+    double baseline;
+    if (!(in >> baselineTicks >> baseline)) {
+        std::cout << " (no baseline in " << FUZZ_BASELINE << ")" << std::endl;
+        return failures == 0;
+    } else if (baselineTicks != ticks) {
+        std::cout << " (the baseline is for " << baselineTicks << " ticks, so it isn't compared)" << std::endl;
+        return failures == 0;
+    }
+
+    bool regressed = perTick > baseline * (1 + FUZZ_TOLERANCE);
+    std::cout << " (baseline " << baseline << ", " << std::showpos << std::setprecision(1)
+              << 100 * (perTick / baseline - 1) << std::noshowpos << "%)" << std::endl;
+    if (regressed)
+        std::cout << "more than " << std::setprecision(0) << 100 * FUZZ_TOLERANCE << "% slower than the baseline" << std::endl;
+
+    return failures == 0 && !regressed;
+}
+
+static void usage() {
+    std::cerr << "usage: ./ping-bench [benchmark] [ticks (defaults to 20000)]" << std::endl
+              << "benchmarks:" << std::endl
+              << "  balls       SharedState::update() cost with 1-256 balls" << std::endl
+              << "  broadphase  brute force vs. grid broadphase with 2-1024 paddles" << std::endl
+              << "  ai          AIInput::update() cost per difficulty, LearnedInput's, and" << std::endl
+              << "              AI vs. update() cost in a 16-player game" << std::endl
+              << "  batch       AIBatch vs. AIInput in 64 16-player rooms; fails if they differ" << std::endl
+              << "  collide     Entity::collide() vs. the scalar reference on random" << std::endl
+              << "              pairs (ticks is the number of pairs); fails if they differ" << std::endl
+              << "  trace       ball path prediction: the old bounce loop vs. reflecting vs." << std::endl
+              << "              unfolding; fails if the last two differ" << std::endl
+              << "  fuzz        SharedState::update() on random arenas, paddle placements and" << std::endl
+              << "              inputs; fails on any broken invariant, or if it's slower than" << std::endl
+              << "              the stored baseline" << std::endl
+              << "  fuzz-baseline  the same, storing the cost per tick as the baseline" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    int ticks = 20000;
+    if (argc > 2)
+        ticks = std::max(1, atoi(argv[2]));
+
+    if (strcmp(argv[1], "balls") == 0)
+        benchBalls(ticks);
+    else if (strcmp(argv[1], "broadphase") == 0)
+        benchBroadphase(ticks);
+    else if (strcmp(argv[1], "ai") == 0)
+        benchAI(ticks);
+    else if (strcmp(argv[1], "batch") == 0)
+        return benchBatch(ticks) ? 0 : 1;
+    else if (strcmp(argv[1], "collide") == 0)
+        return benchCollide(ticks) ? 0 : 1;
+    else if (strcmp(argv[1], "trace") == 0)
+        return benchTrace(ticks) ? 0 : 1;
+    else if (strcmp(argv[1], "fuzz") == 0 || strcmp(argv[1], "fuzz-baseline") == 0)
+        return fuzz(ticks, strcmp(argv[1], "fuzz-baseline") == 0) ? 0 : 1;
+    else {
+        usage();
+        return 1;
+    }
+
+    return 0;
+}
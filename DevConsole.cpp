@@ -38,6 +38,10 @@ bool DevConsole::handleCommand(std::string input) {
     split(input, ' ', elems);
     if (elems.size() < 1)
         return false;
+    if (elems[0] == "hud") {
+        m->hud.visible = !m->hud.visible;
+        return true;
+    }
     if (elems[0] == "push" && elems.size() >= 2) {
         if (elems[1] == "game" && elems.size() >= 4) {
             std::vector<PaddleInput *> inputs(2);
@@ -64,8 +68,13 @@ bool DevConsole::handleCommand(std::string input) {
                 m->pushState(new Game(m, inputs[0], host));
             }
 
-            if (host == NULL)
-                m->pushState(new Game(m, inputs, 2));
+            if (host == NULL) {
+                // An optional fifth argument sets the number of balls.
+                int numBalls = 1;
+                if (elems.size() >= 5)
+                    numBalls = std::max(1, atoi(elems[4].c_str()));
+                m->pushState(new Game(m, inputs, 2, false, false, numBalls));
+            }
 
             return true;
         }
@@ -1,24 +1,73 @@
+#include <algorithm>
 #include "Entity.h"
+#include "simd.h"
 
-Entity::Entity() : x(0), y(0), w(0), h(0), theta(0), v(0), orientation(0) {}
+Entity::Entity() : x(0), y(0), w(0), h(0), dx(0), dy(0), orientation(0), cosOrientation(1), sinOrientation(0) {}
 
-Entity::Entity(int w, int h) : x(0), y(0), w(w), h(h), theta(0), v(0), orientation(0) {}
+Entity::Entity(int w, int h) : x(0), y(0), w(w), h(h), dx(0), dy(0), orientation(0), cosOrientation(1), sinOrientation(0) {}
 
-// theta and v are 0 by default (see Entity.h).
+// theta, v and orientation are 0 by default (see Entity.h).
 Entity::Entity(double x, double y, int w, int h, double theta, double v, double orientation)
-    : x(x), y(y), w(w), h(h), theta(theta), v(v), orientation(orientation) {
+    : x(x), y(y), w(w), h(h), dx(v * cos(theta)), dy(v * sin(theta)) {
+    setOrientation(orientation);
+}
+
+Entity::Entity(double x, double y, int w, int h, double dx, double dy, double orientation, double cosOrientation, double sinOrientation)
+    : x(x), y(y), w(w), h(h), dx(dx), dy(dy),
+      orientation(orientation), cosOrientation(cosOrientation), sinOrientation(sinOrientation) {
 }
 
 double Entity::getDX() const {
-    return v * cos(theta);
+    return dx;
 }
 
 double Entity::getDY() const {
-    return v * sin(theta);
+    return dy;
 }
 
 double Entity::getSlope() const {
-    return tan(theta);
+    return dy / dx;
+}
+
+double Entity::getTheta() const {
+    return atan2(dy, dx);
+}
+
+double Entity::getV() const {
+    return sqrt(dx*dx + dy*dy);
+}
+
+void Entity::setTheta(double theta) {
+    double v = getV();
+    dx = v * cos(theta);
+    dy = v * sin(theta);
+}
+
+// Keeps the current heading; setting the speed of a stationary entity
+// sends it along +X.
+void Entity::setV(double v) {
+    double oldV = getV();
+    if (oldV == 0) {
+        dx = v;
+        dy = 0;
+    } else {
+        dx *= v / oldV;
+        dy *= v / oldV;
+    }
+}
+
+double Entity::getOrientation() const {
+    return orientation;
+}
+
+void Entity::setOrientation(double orientation) {
+    setOrientation(orientation, cos(orientation), sin(orientation));
+}
+
+void Entity::setOrientation(double orientation, double cosOrientation, double sinOrientation) {
+    this->orientation = orientation;
+    this->cosOrientation = cosOrientation;
+    this->sinOrientation = sinOrientation;
 }
 
 Vector2 Entity::getCenter() const {
@@ -26,26 +75,31 @@ Vector2 Entity::getCenter() const {
 }
 
 std::vector<Vector2> Entity::getVertices() const {
+    Vector2 vertices[4];
+    getVertices(vertices);
+    return std::vector<Vector2>(vertices, vertices + 4);
+}
+
+void Entity::getVertices(Vector2 vertices[4]) const {
     Vector2 c = getCenter();
-    return {
-        Vector2(c.x - cos(orientation) * w/2 + sin(orientation) * h/2, c.y - sin(orientation) * w/2 - cos(orientation) * h/2),
-        Vector2(c.x + cos(orientation) * w/2 + sin(orientation) * h/2, c.y + sin(orientation) * w/2 - cos(orientation) * h/2),
-        Vector2(c.x + cos(orientation) * w/2 - sin(orientation) * h/2, c.y + sin(orientation) * w/2 + cos(orientation) * h/2),
-        Vector2(c.x - cos(orientation) * w/2 - sin(orientation) * h/2, c.y - sin(orientation) * w/2 + cos(orientation) * h/2)
-    };
+    double co = cosOrientation, so = sinOrientation;
+    vertices[0] = Vector2(c.x - co * w/2 + so * h/2, c.y - so * w/2 - co * h/2);
+    vertices[1] = Vector2(c.x + co * w/2 + so * h/2, c.y + so * w/2 - co * h/2);
+    vertices[2] = Vector2(c.x + co * w/2 - so * h/2, c.y + so * w/2 + co * h/2);
+    vertices[3] = Vector2(c.x - co * w/2 - so * h/2, c.y - so * w/2 + co * h/2);
 }
 
 void Entity::setDelta(double dX, double dY) {
-    theta = atan2(dY, dX);
-    v = sqrt(dX*dX + dY*dY);
+    dx = dX;
+    dy = dY;
 }
 
 void Entity::setDX(double dX) {
-    setDelta(dX, getDY());
+    dx = dX;
 }
 
 void Entity::setDY(double dY) {
-    setDelta(getDX(), dY);
+    dy = dY;
 }
 
 void Entity::setCenter(double cX, double cY) {
@@ -57,8 +111,84 @@ void Entity::setCenter(const Vector2 &c) {
     setCenter(c.x, c.y);
 }
 
+// Separating axis test for two oriented boxes. The four axes are all
+// checked at once, each vertex being projected onto every axis in a
+// couple of vector operations; boxes whose bounding boxes are well
+// apart are ruled out before any of that.
 // projections is NULL by default (see Entity.h).
 bool Entity::collide(const Entity &other, std::vector<Vector2> *projections) const {
+#ifndef PING_SIMD
+    return collideReference(other, projections);
+#else
+    if (projections == NULL && orientation == 0 && other.orientation == 0)
+        return (y + h >= other.y && y <= other.y + other.h && x + w >= other.x && x <= other.x + other.w);
+
+    Vector2 vertices[8];
+    getVertices(vertices);
+    other.getVertices(vertices + 4);
+
+    // The margin keeps this from disagreeing with the exact test below
+    // about boxes that are just touching.
+    Vector2::Scalar bounds[2][4];
+    for (int e = 0; e < 2; e++) {
+        bounds[e][0] = bounds[e][2] = vertices[e*4].x;
+        bounds[e][1] = bounds[e][3] = vertices[e*4].y;
+        for (int v = e*4 + 1; v < e*4 + 4; v++) {
+            bounds[e][0] = std::min(bounds[e][0], vertices[v].x);
+            bounds[e][1] = std::min(bounds[e][1], vertices[v].y);
+            bounds[e][2] = std::max(bounds[e][2], vertices[v].x);
+            bounds[e][3] = std::max(bounds[e][3], vertices[v].y);
+        }
+    }
+    if (bounds[0][0] > bounds[1][2] + 1 || bounds[1][0] > bounds[0][2] + 1 ||
+        bounds[0][1] > bounds[1][3] + 1 || bounds[1][1] > bounds[0][3] + 1)
+        return false;
+
+    Vector2 axis[4] = { (vertices[1] - vertices[0]).unit(), (vertices[0] - vertices[3]).unit(),
+                        (vertices[5] - vertices[4]).unit(), (vertices[4] - vertices[7]).unit() };
+    double axisX[4], axisY[4], overlap[4];
+    for (int a = 0; a < 4; a++) {
+        axisX[a] = axis[a].x;
+        axisY[a] = axis[a].y;
+    }
+
+    // Comparisons are written to pick the same operand as std::min()
+    // and std::max() in collideReference().
+    bool separated = false;
+    for (int a = 0; a < 4; a += SIMD_WIDTH) {
+        doublev ax = loadv(axisX + a), ay = loadv(axisY + a);
+        doublev min[2], max[2];
+        for (int e = 0; e < 2; e++) {
+            min[e] = max[e] = broadcastv(vertices[e*4].x) * ax + broadcastv(vertices[e*4].y) * ay;
+            for (int v = e*4 + 1; v < e*4 + 4; v++) {
+                doublev prod = broadcastv(vertices[v].x) * ax + broadcastv(vertices[v].y) * ay;
+                min[e] = min[e] < prod ? min[e] : prod;
+                max[e] = prod < max[e] ? max[e] : prod;
+            }
+        }
+
+        longv apart = (min[0] > max[1]) | (min[1] > max[0]);
+        for (int lane = 0; lane < SIMD_WIDTH; lane++)
+            separated |= apart[lane] != 0;
+
+        doublev outer = (max[0] < max[1] ? max[1] : max[0]) - (min[1] < min[0] ? min[1] : min[0]);
+        storev(overlap + a, max[0] - min[0] + max[1] - min[1] - outer);
+    }
+
+    if (separated)
+        return false;
+
+    if (projections != NULL) {
+        for (int a = 0; a < 4; a++)
+            projections->push_back(axis[a] * overlap[a]);
+    }
+
+    return true;
+#endif
+}
+
+// projections is NULL by default (see Entity.h).
+bool Entity::collideReference(const Entity &other, std::vector<Vector2> *projections) const {
     if (projections == NULL && orientation == 0 && other.orientation == 0)
         return (y + h >= other.y && y <= other.y + other.h && x + w >= other.x && x <= other.x + other.w);
 
@@ -67,6 +197,7 @@ bool Entity::collide(const Entity &other, std::vector<Vector2> *projections) con
 
     Vector2 axis[4] = { (vertices[1] - vertices[0]).unit(), (vertices[0] - vertices[3]).unit(),
                         (otherVertices[1] - otherVertices[0]).unit(), (otherVertices[0] - otherVertices[3]).unit() };
+    Vector2 found[4];
 
     for (int a = 0; a < 4; a++) {
         double min[2] = { vertices[0] * axis[a], otherVertices[0] * axis[a] };
@@ -85,16 +216,83 @@ bool Entity::collide(const Entity &other, std::vector<Vector2> *projections) con
         
         if (min[0] > max[1] || min[1] > max[0]) {
             return false;
-        } else if (projections != NULL) {
+        } else {
             double overlap = max[0] - min[0] + max[1] - min[1] - (std::max(max[0], max[1]) - std::min(min[0], min[1]));
-            projections->push_back(axis[a] * overlap);
+            found[a] = axis[a] * overlap;
+        }
+    }
+
+    if (projections != NULL)
+        projections->insert(projections->end(), found, found + 4);
+
+    return true;
+}
+
+// Like collide(), but with this entity moving by delta while other
+// stays still: returns true if they come into contact during the move,
+// setting time to the fraction of delta covered at first contact and
+// filling in projections as collide() would at that moment. Entities
+// that already overlap are left to collide().
+// projections is NULL by default (see Entity.h).
+bool Entity::sweep(const Entity &other, const Vector2 &delta, double &time, std::vector<Vector2> *projections) const {
+    std::vector<Vector2> vertices = getVertices();
+    std::vector<Vector2> otherVertices = other.getVertices();
+
+    Vector2 axis[4] = { (vertices[1] - vertices[0]).unit(), (vertices[0] - vertices[3]).unit(),
+                        (otherVertices[1] - otherVertices[0]).unit(), (otherVertices[0] - otherVertices[3]).unit() };
+
+    double min[4][2], max[4][2], speed[4];
+    double enter = -INFINITY, exit = INFINITY;
+
+    for (int a = 0; a < 4; a++) {
+        min[a][0] = max[a][0] = vertices[0] * axis[a];
+        min[a][1] = max[a][1] = otherVertices[0] * axis[a];
+
+        for (int v = 1; v < 4; v++) {
+            double prod = vertices[v] * axis[a];
+            double otherProd = otherVertices[v] * axis[a];
+
+            min[a][0] = std::min(prod, min[a][0]);
+            max[a][0] = std::max(prod, max[a][0]);
+
+            min[a][1] = std::min(otherProd, min[a][1]);
+            max[a][1] = std::max(otherProd, max[a][1]);
+        }
+
+        // The projections overlap between the times this entity's
+        // leading edge reaches the other's near edge and its trailing
+        // edge leaves the far one.
+        speed[a] = delta * axis[a];
+        if (speed[a] == 0) {
+            if (min[a][0] > max[a][1] || min[a][1] > max[a][0])
+                return false;
+        } else {
+            double t0 = (min[a][1] - max[a][0]) / speed[a];
+            double t1 = (max[a][1] - min[a][0]) / speed[a];
+            if (t0 > t1)
+                std::swap(t0, t1);
+            enter = std::max(enter, t0);
+            exit = std::min(exit, t1);
+        }
+    }
+
+    if (enter > exit || enter > 1 || enter < 0)
+        return false;
+
+    time = enter;
+
+    if (projections != NULL) {
+        for (int a = 0; a < 4; a++) {
+            double shift = speed[a] * time;
+            double overlap = std::min(max[a][0] + shift, max[a][1]) - std::max(min[a][0] + shift, min[a][1]);
+            projections->push_back(axis[a] * std::max(0.0, overlap));
         }
     }
 
     return true;
 }
 
-void Entity::update() {
-    x += getDX();
-    y += getDY();
+void Entity::update(double dt) {
+    x += dx * dt;
+    y += dy * dt;
 }
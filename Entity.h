@@ -11,22 +11,37 @@ class Entity {
 public:
     double x, y;
     int w, h;
-    // NOTE: Angles are in radians, and go clockwise from +X (due to
-    // +Y being down).
-    double theta, v;
-    double orientation;
+    // Velocity, in pixels per second. This (rather than a heading and a
+    // speed) is what's stored, so that moving and bouncing entities
+    // doesn't need any trig.
+    double dx, dy;
 
     Entity();
     Entity(int w, int h);
+    // NOTE: Angles are in radians, and go clockwise from +X (due to
+    // +Y being down).
     Entity(double x, double y, int w, int h, double theta=0, double v=0, double orientation=0);
+    // For when the cosine and sine of the orientation are already known.
+    Entity(double x, double y, int w, int h, double dx, double dy, double orientation, double cosOrientation, double sinOrientation);
 
     double getDX() const;
     double getDY() const;
     double getSlope() const;
 
+    // Polar versions of the velocity.
+    double getTheta() const;
+    double getV() const;
+    void setTheta(double theta);
+    void setV(double v);
+
+    double getOrientation() const;
+    void setOrientation(double orientation);
+    void setOrientation(double orientation, double cosOrientation, double sinOrientation);
+
     Vector2 getCenter() const;
 
     std::vector<Vector2> getVertices() const;
+    void getVertices(Vector2 vertices[4]) const;
 
     void setDelta(double dX, double dY);
     void setDX(double dX);
@@ -35,9 +50,22 @@ public:
     void setCenter(double cX, double cY);
     void setCenter(const Vector2 &c);
 
+    // projections is only filled in if they collide.
     bool collide(const Entity &other, std::vector<Vector2> *projections=NULL) const;
+    // The plain scalar version of collide(), which the vectorized one
+    // must match exactly.
+    bool collideReference(const Entity &other, std::vector<Vector2> *projections=NULL) const;
+    bool sweep(const Entity &other, const Vector2 &delta, double &time, std::vector<Vector2> *projections=NULL) const;
+
+    // Moves the entity by its velocity over dt seconds.
+    void update(double dt);
 
-    void update();
+private:
+    friend class EntityStore;
+
+    double orientation;
+    // The cached basis of the entity's own axes.
+    double cosOrientation, sinOrientation;
 };
 
 #endif
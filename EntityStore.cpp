@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <math.h>
+#include "EntityStore.h"
+#include "simd.h"
+
+unsigned int EntityStore::size() const {
+    return x.size();
+}
+
+void EntityStore::resize(unsigned int n) {
+    x.resize(n);
+    y.resize(n);
+    w.resize(n);
+    h.resize(n);
+    v.resize(n);
+    orientation.resize(n);
+    cosTheta.resize(n, 1);
+    sinTheta.resize(n);
+    cosOrientation.resize(n, 1);
+    sinOrientation.resize(n);
+}
+
+const Entity EntityStore::operator[](unsigned int n) const {
+    return Entity(x[n], y[n], w[n], h[n], getDX(n), getDY(n), orientation[n], cosOrientation[n], sinOrientation[n]);
+}
+
+void EntityStore::set(unsigned int n, const Entity &entity) {
+    x[n] = entity.x;
+    y[n] = entity.y;
+    w[n] = entity.w;
+    h[n] = entity.h;
+    setVelocity(n, entity.dx, entity.dy);
+    orientation[n] = entity.orientation;
+    cosOrientation[n] = entity.cosOrientation;
+    sinOrientation[n] = entity.sinOrientation;
+}
+
+double EntityStore::getTheta(unsigned int n) const {
+    return atan2(sinTheta[n], cosTheta[n]);
+}
+
+void EntityStore::setTheta(unsigned int n, double theta) {
+    cosTheta[n] = cos(theta);
+    sinTheta[n] = sin(theta);
+}
+
+void EntityStore::setVelocity(unsigned int n, double dx, double dy) {
+    if (dx * sinTheta[n] - dy * cosTheta[n] == 0) {
+        v[n] = dx * cosTheta[n] + dy * sinTheta[n];
+        return;
+    }
+
+    v[n] = sqrt(dx*dx + dy*dy);
+    cosTheta[n] = dx / v[n];
+    sinTheta[n] = dy / v[n];
+}
+
+void EntityStore::setOrientation(unsigned int n, double orientation) {
+    this->orientation[n] = orientation;
+    cosOrientation[n] = cos(orientation);
+    sinOrientation[n] = sin(orientation);
+}
+
+void EntityStore::setCenter(unsigned int n, double cX, double cY) {
+    x[n] = cX - w[n]/2.0;
+    y[n] = cY - h[n]/2.0;
+}
+
+double EntityStore::getDX(unsigned int n) const {
+    return v[n] * cosTheta[n];
+}
+
+double EntityStore::getDY(unsigned int n) const {
+    return v[n] * sinTheta[n];
+}
+
+Vector2 EntityStore::getCenter(unsigned int n) const {
+    return Vector2(x[n] + w[n]/2, y[n] + h[n]/2);
+}
+
+void EntityStore::getVertices(unsigned int n, Vector2 vertices[4]) const {
+    Vector2 c = getCenter(n);
+    double co = cosOrientation[n], so = sinOrientation[n];
+    vertices[0] = Vector2(c.x - co * w[n]/2 + so * h[n]/2, c.y - so * w[n]/2 - co * h[n]/2);
+    vertices[1] = Vector2(c.x + co * w[n]/2 + so * h[n]/2, c.y + so * w[n]/2 - co * h[n]/2);
+    vertices[2] = Vector2(c.x + co * w[n]/2 - so * h[n]/2, c.y + so * w[n]/2 + co * h[n]/2);
+    vertices[3] = Vector2(c.x - co * w[n]/2 - so * h[n]/2, c.y - so * w[n]/2 + co * h[n]/2);
+}
+
+// padding is 0 by default (see EntityStore.h).
+AABB EntityStore::getBounds(unsigned int n, double padding) const {
+    Vector2 vertices[4];
+    getVertices(n, vertices);
+    AABB box = { vertices[0].x, vertices[0].y, vertices[0].x, vertices[0].y };
+    for (int v = 1; v < 4; v++) {
+        box.minX = std::min<double>(box.minX, vertices[v].x);
+        box.minY = std::min<double>(box.minY, vertices[v].y);
+        box.maxX = std::max<double>(box.maxX, vertices[v].x);
+        box.maxY = std::max<double>(box.maxY, vertices[v].y);
+    }
+
+    box.minX -= padding;
+    box.minY -= padding;
+    box.maxX += padding;
+    box.maxY += padding;
+    return box;
+}
+
+void EntityStore::update(double dt) {
+    double *px = x.data(), *py = y.data();
+    const double *pv = v.data(), *pc = cosTheta.data(), *ps = sinTheta.data();
+    unsigned int i = 0;
+#ifdef PING_SIMD
+    const doublev step = broadcastv(dt);
+    for (; i + SIMD_WIDTH <= size(); i += SIMD_WIDTH) {
+        doublev speed = loadv(pv + i) * step;
+        storev(px + i, loadv(px + i) + speed * loadv(pc + i));
+        storev(py + i, loadv(py + i) + speed * loadv(ps + i));
+    }
+#endif
+    for (; i < size(); i++) {
+        double speed = pv[i] * dt;
+        px[i] += speed * pc[i];
+        py[i] += speed * ps[i];
+    }
+}
+
+// The cached cosine/sine are rotated rather than recomputed, which
+// drifts from the angle by about an ulp per step: far too little to
+// ever see.
+void EntityStore::spin(const std::vector<double> &rotations, double dt, const std::vector<Vector2> &turns) {
+    for (unsigned int i = 0; i < size(); i++) {
+        if (rotations[i] != 0) {
+            double co = cosOrientation[i], so = sinOrientation[i];
+            orientation[i] += rotations[i] * dt;
+            cosOrientation[i] = co * turns[i].x - so * turns[i].y;
+            sinOrientation[i] = so * turns[i].x + co * turns[i].y;
+        }
+    }
+}
+
+void EntityStore::testLine(const Vector2 &start, const Vector2 &end, unsigned char *outside) const {
+    unsigned int i = 0;
+#ifdef PING_SIMD
+    // This mirrors getVertices() operation for operation, so the
+    // results are identical to the scalar test below.
+    const doublev startX = broadcastv(start.x), startY = broadcastv(start.y);
+    const doublev lineX = broadcastv(end.x - start.x), lineY = broadcastv(end.y - start.y);
+    const doublev zero = broadcastv(0);
+
+    for (; i + SIMD_WIDTH <= size(); i += SIMD_WIDTH) {
+        int halfW[SIMD_WIDTH], halfH[SIMD_WIDTH];
+        for (int lane = 0; lane < SIMD_WIDTH; lane++) {
+            halfW[lane] = w[i+lane]/2;
+            halfH[lane] = h[i+lane]/2;
+        }
+
+        doublev width = loadv(&w[i]), height = loadv(&h[i]);
+        doublev cx = loadv(&x[i]) + loadv(halfW), cy = loadv(&y[i]) + loadv(halfH);
+        doublev co = loadv(&cosOrientation[i]), so = loadv(&sinOrientation[i]);
+        doublev cw = co * width / 2, sw = so * width / 2;
+        doublev ch = co * height / 2, sh = so * height / 2;
+
+        doublev vx[4] = { cx - cw + sh, cx + cw + sh, cx + cw - sh, cx - cw - sh };
+        doublev vy[4] = { cy - sw - ch, cy + sw - ch, cy + sw + ch, cy - sw + ch };
+
+        longv mask = {};
+        for (int v = 0; v < 4; v++) {
+            doublev side = lineX * (vy[v] - startY) - lineY * (vx[v] - startX);
+            mask |= ~(side > zero) & (1 << v);
+        }
+
+        for (int lane = 0; lane < SIMD_WIDTH; lane++)
+            outside[i+lane] = mask[lane];
+    }
+#endif
+    for (; i < size(); i++) {
+        Vector2 vertices[4];
+        getVertices(i, vertices);
+        outside[i] = 0;
+        for (int v = 0; v < 4; v++) {
+            if (!(((end.x-start.x)*(vertices[v].y-start.y) - (end.y-start.y)*(vertices[v].x-start.x)) > 0))
+                outside[i] |= 1 << v;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+// -*- c++ -*-
+#ifndef PING_ENTITY_STORE_H
+#define PING_ENTITY_STORE_H
+
+#include <vector>
+#include "Entity.h"
+#include "SpatialGrid.h"
+#include "Vector2.h"
+
+// Structure-of-arrays storage for a group of entities (such as all of
+// the paddles in an arena). Each field gets its own contiguous array,
+// so that passes over every entity in a tick can be vectorized, and
+// motion is kept as a (signed) speed v along a unit direction
+// (cosTheta, sinTheta), with the orientation's cosine/sine cached too,
+// so that no trig is needed unless an angle is set explicitly.
+class EntityStore {
+public:
+    std::vector<double> x, y;
+    std::vector<int> w, h;
+    std::vector<double> v, orientation;
+    std::vector<double> cosTheta, sinTheta;
+    std::vector<double> cosOrientation, sinOrientation;
+
+    unsigned int size() const;
+    void resize(unsigned int n);
+
+    // Entity views are copies; changes must be written back with set()
+    // (or directly to the arrays), which is why they're returned const.
+    const Entity operator[](unsigned int n) const;
+    void set(unsigned int n, const Entity &entity);
+
+    double getTheta(unsigned int n) const;
+    void setTheta(unsigned int n, double theta);
+    // A velocity along the current direction (as a paddle's always is)
+    // keeps that direction, with a negative speed if it's backwards.
+    void setVelocity(unsigned int n, double dx, double dy);
+    void setOrientation(unsigned int n, double orientation);
+    void setCenter(unsigned int n, double cX, double cY);
+
+    double getDX(unsigned int n) const;
+    double getDY(unsigned int n) const;
+    Vector2 getCenter(unsigned int n) const;
+    // Same vertex order as Entity::getVertices().
+    void getVertices(unsigned int n, Vector2 vertices[4]) const;
+    // Bounding box of the nth entity, grown by padding on every side.
+    AABB getBounds(unsigned int n, double padding=0) const;
+
+    // Moves every entity by its velocity over dt.
+    void update(double dt);
+    // Adds rotations[n] * dt to the orientation of entity n, given the
+    // cosines and sines of those angles.
+    void spin(const std::vector<double> &rotations, double dt, const std::vector<Vector2> &turns);
+    // Side-of-line test for every vertex of every entity, matching the
+    // boundary checks in SharedState::update(): bit v of outside[n] is
+    // set if vertex v of entity n is not strictly inside (left of)
+    // the line from start to end.
+    void testLine(const Vector2 &start, const Vector2 &end, unsigned char *outside) const;
+};
+
+#endif
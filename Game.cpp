@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <sstream>
 #include "GameManager.h"
 #include "Game.h"
@@ -8,22 +9,25 @@
 #include "utility.h"
 
 Texture Game::whiteTexture;
+std::map<std::vector<double>, std::shared_ptr<Texture>> Game::overlays;
 
-// classic and demo are false by default (see Game.h).
-Game::Game(GameManager *m, std::vector<PaddleInput *> inputs, int wallsPerPlayer, bool classic, bool demo)
-    : GameState(m), state(this), inputs(inputs), server(NULL), networked(false), classic(classic), demo(demo) {
+// classic and demo are false and numBalls is 1 by default (see Game.h).
+Game::Game(GameManager *m, std::vector<PaddleInput *> inputs, int wallsPerPlayer, bool classic, bool demo, int numBalls)
+    : GameState(m), state(this), inputs(inputs), server(NULL), failed(false), pinging(false), pingNum(0), networked(false), classic(classic),
+      demo(demo) {
     setupStatic();
 
     if (classic)
-        state.resetClassic();
+        state.resetClassic(numBalls);
     else
-        state.reset(inputs.size(), wallsPerPlayer);
+        state.reset(inputs.size(), wallsPerPlayer, numBalls);
 
     setupTextures();
+    publishFirst();
 }
 
 Game::Game(GameManager *m, PaddleInput *input, const char *host)
-    : GameState(m), inputs{input}, server(NULL), networked(true), demo(false) {
+    : GameState(m), inputs{input}, server(NULL), failed(false), pinging(false), pingNum(0), networked(true), demo(false) {
     setupStatic();
 
     IPaddress ip;
@@ -66,24 +70,33 @@ Game::Game(GameManager *m, PaddleInput *input, const char *host)
     playerNum = server->getByte();
     int numPlayers = server->getByte();
     int wallsPerPlayer = server->getByte();
+    int numBalls = server->getUint16();
+    int tickRate = server->getUint16();
+    if (tickRate < 1 || tickRate > SharedState::PHYSICS_RATE) {
+        errorScreen("Unsupported tick rate.");
+        return;
+    }
 
     if (numPlayers == 2 && wallsPerPlayer == 2)
         classic = server->getByte();
 
     if (classic)
-        state.resetClassic();
+        state.resetClassic(numBalls);
     else
-        state.reset(numPlayers, wallsPerPlayer);
+        state.reset(numPlayers, wallsPerPlayer, numBalls);
+    state.setTickRate(tickRate);
 
     setupTextures();
 
-    for (auto &player : state.players) {
-        player.x = server->getDouble();
-        player.y = server->getDouble();
+    for (unsigned int i = 0; i < state.players.size(); i++) {
+        state.players.x[i] = server->getDouble();
+        state.players.y[i] = server->getDouble();
     }
 
     if (server->error)
         errorScreen("Server disconnected.");
+    else
+        publishFirst();
 }
 
 Game::~Game() {
@@ -91,9 +104,12 @@ Game::~Game() {
         delete input;
 
     delete server;
+    if (networked)
+        m->hud.resetNetwork();
 }
 
 void Game::setupTextures() {
+    const ArenaGeometry &arena = *state.geometry;
     SDL_Texture *target = SDL_CreateTexture(m->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, m->WIDTH, m->HEIGHT);
     SDL_SetRenderTarget(m->renderer, target);
 
@@ -108,28 +124,40 @@ void Game::setupTextures() {
     double w = 32 * state.scale, h = 12 * state.scale, total = w + 14 * state.scale;
     if (classic) {
         for (int b = 0; b <= m->HEIGHT / total; b++)
-            whiteTexture.render(m->renderer, (m->WIDTH-h)/2, (int)round(b * total), (int)round(h), (int)round(w));
+            batch.add(NULL, (int)((m->WIDTH-h)/2), (int)round(b * total), (int)round(h), (int)round(w));
     } else {
-        whiteTexture.setColorMod(0x88, 0x88, 0x88);
+        SDL_Color gray = { 0x88, 0x88, 0x88, 0xff };
         for (unsigned int i = 0; i < state.boundaries.size(); i++) {
             Vector2 start = state.boundaries[i];
-            Vector2 end = state.boundaries[(i + 1) % state.boundaries.size()];
-            double angle = atan2((end-start).y, (end-start).x);
+            double angle = arena.angles[(i + 1) % state.boundaries.size()];
             angle += pi/2 - pi / state.boundaries.size();
             double x = start.x + w/2 * cos(angle) - w/2;
             double y = start.y + w/2 * sin(angle) - h/2;
             for (int b = 0; b <= (int)(distToCenter / total); b++) {
-                whiteTexture.render(m->renderer, (int)round(x), (int)round(y), (int)round(w), (int)round(h), angle * 180/pi);
+                batch.add(NULL, (int)round(x), (int)round(y), (int)round(w), (int)round(h), angle * 180/pi, gray);
                 x += total * cos(angle);
                 y += total * sin(angle);
             }
         }
-        whiteTexture.setColorMod(0xff, 0xff, 0xff);
     }
+    batch.render(m->renderer, whiteTexture);
 
     SDL_SetRenderTarget(m->renderer, NULL);
     background = Texture(target);
 
+    // The overlay only depends on the arena's shape, which only
+    // depends on how it was set up, so it's shared between games.
+    std::vector<double> key;
+    for (const Vector2 &boundary : state.boundaries) {
+        key.push_back(boundary.x);
+        key.push_back(boundary.y);
+    }
+    std::map<std::vector<double>, std::shared_ptr<Texture>>::iterator cached = overlays.find(key);
+    if (cached != overlays.end()) {
+        overlay = cached->second;
+        return;
+    }
+
     Uint32 rmask, gmask, bmask, amask;
 
     // This is annoying, but seemingly necessary since an amask of 0
@@ -148,26 +176,62 @@ void Game::setupTextures() {
 #endif
 
     SDL_Surface *overlaySurf = SDL_CreateRGBSurface(0, m->WIDTH, m->HEIGHT, 32, rmask, gmask, bmask, amask);
+    maskOverlay(overlaySurf, arena, amask);
 
-    for (int x = 0; x < m->WIDTH; x++) {
-        for (int y = 0; y < m->HEIGHT; y++) {
-            bool interior = true;
-            for (unsigned int i = 0; i < state.boundaries.size(); i++) {
-                Vector2 start = state.boundaries[i];
-                Vector2 end = state.boundaries[(i + 1) % state.boundaries.size()];
-                if (((end.x-start.x)*(y-start.y) - (end.y-start.y)*(x-start.x)) < -500) {
-                    interior = false;
-                    break;
-                }
-            }
+    if (overlays.size() >= MAX_OVERLAYS)
+        overlays.erase(overlays.begin());
+    overlay = overlays[key] = std::make_shared<Texture>(Texture::fromSurface(m->renderer, overlaySurf));
+    SDL_FreeSurface(overlaySurf);
+}
 
-            if (!interior)
-                ((Uint32 *)overlaySurf->pixels)[y*m->WIDTH+x] = amask;
-        }
+// Pixels more than a little way outside any edge are masked off; the
+// margin is in units of edge length, hence the per-edge limits. What's
+// left is a convex polygon, so each row's unmasked pixels are a single
+// run, found from where the row crosses each edge's limit (and then
+// checked pixel by pixel at its ends, against rounding).
+void Game::maskOverlay(SDL_Surface *surface, const ArenaGeometry &arena, Uint32 color) {
+    std::vector<double> limits(arena.edges.size());
+    for (unsigned int i = 0; i < arena.edges.size(); i++) {
+        Vector2 edge = arena.edges[i];
+        limits[i] = arena.offsets[i] - 500 / edge.length();
     }
 
-    overlay = Texture::fromSurface(m->renderer, overlaySurf);
-    SDL_FreeSurface(overlaySurf);
+    auto interior = [&](int x, int y) {
+        Vector2 p(x, y);
+        for (unsigned int i = 0; i < arena.edges.size(); i++) {
+            if (arena.normals[i] * p < limits[i])
+                return false;
+        }
+        return true;
+    };
+
+    for (int y = 0; y < surface->h; y++) {
+        double lo = 0, hi = surface->w - 1;
+        for (unsigned int i = 0; i < arena.edges.size(); i++) {
+            // normals[i].x * x >= limits[i] - normals[i].y * y
+            double a = arena.normals[i].x, b = limits[i] - arena.normals[i].y * y;
+            if (a > 0)
+                lo = std::max(lo, b / a);
+            else if (a < 0)
+                hi = std::min(hi, b / a);
+            else if (b > 0)
+                lo = surface->w;
+        }
+
+        int start = surface->w, end = surface->w;
+        if (lo <= hi) {
+            start = std::max(0, (int)ceil(lo) - 1);
+            end = std::min(surface->w, (int)floor(hi) + 2);
+            while (start < end && !interior(start, y))
+                start++;
+            while (end > start && !interior(end - 1, y))
+                end--;
+        }
+
+        Uint32 *row = (Uint32 *)((Uint8 *)surface->pixels + y * surface->pitch);
+        std::fill(row, row + start, color);
+        std::fill(row + end, row + surface->w, color);
+    }
 }
 
 void Game::setupStatic() {
@@ -184,6 +248,32 @@ void Game::errorScreen(const char *msg) {
     valid = false;
 }
 
+void Game::fail(const char *msg) {
+    failure = msg;
+    failed = true;
+}
+
+void Game::publish() {
+    Snapshot &snapshot = snapshots.back();
+    snapshot.state = state;
+    snapshot.time = m->now();
+    snapshots.publish();
+}
+
+// Called from the constructors (on the main thread, before update() can
+// be), so that render() has a snapshot to draw, and a previous one.
+void Game::publishFirst() {
+    publish();
+    snapshots.update();
+    previous = snapshots.front();
+}
+
+void Game::seed(unsigned int seed) {
+    state.seed(seed);
+    state.resetBalls();
+    publishFirst();
+}
+
 void Game::onBounce() {
     if (!demo)
         Mix_PlayChannel(-1, m->bounceSound, 0);
@@ -195,11 +285,15 @@ void Game::onHit() {
 }
 
 void Game::update() {
+    if (failed)
+        return;
+
     if (!networked) {
         std::vector<int> inputValues(state.players.size());
         for (unsigned int i = 0; i < state.players.size(); i++)
             inputValues[i] = inputs[i]->update(state, i);
         state.update(inputValues);
+        publish();
         return;
     }
 
@@ -212,101 +306,180 @@ void Game::update() {
             if (sounds & 2)
                 onHit();
 
-            std::vector<Entity *> entities = state.getEntities();
-            int changedEntities = server->getByte();
+            int changedEntities = server->getUint16();
             for (int i = 0; i < changedEntities; i++) {
-                int entityNum = server->getByte();
+                int entityNum = server->getUint16();
                 int numUpdates = server->getByte();
+                Entity entity = state.getEntity(entityNum);
                 for (int up = 0; up < numUpdates; up++) {
                     int field = server->getByte();
                     Uint64 val = server->getUint64();
                     if (field == EntityField::X)
-                        entities[entityNum]->x = *((double *)&val);
+                        entity.x = bitsToDouble(val);
                     else if (field == EntityField::Y)
-                        entities[entityNum]->y = *((double *)&val);
+                        entity.y = bitsToDouble(val);
+                    else if (field == EntityField::SPEED)
+                        entity.setV(bitsToDouble(val));
                     else if (field == EntityField::SCORE)
-                        state.scores[entityNum-1] = val;
+                        state.scores[entityNum - state.balls.size()] = val;
                 }
+                state.setEntity(entityNum, entity);
             }
         } else if (op == Server::DISCONNECT) {
             // TODO: Indicate that a player left.
             server->getByte();
+        } else if (op == Server::PONG) {
+            if (server->getByte() == pingNum && pinging) {
+                m->hud.addPing(std::chrono::duration<double>(Clock::now() - pingTime).count());
+                pinging = false;
+            }
         } else {
-            errorScreen("Unknown directive from server.");
+            fail("Unknown directive from server.");
             return;
         }
     }
 
     if (server->error) {
-        errorScreen("Host disconnected.");
+        fail("Host disconnected.");
         return;
     }
+    publish();
 
     char buf[2];
     buf[0] = Client::MOVE;
     buf[1] = inputs[0]->update(state, 0);
     server->send(buf, 2);
+
+    // One ping is out at a time.
+    if (!pinging && Clock::now() - pingTime >= std::chrono::milliseconds(PING_INTERVAL)) {
+        buf[0] = Client::PING;
+        buf[1] = ++pingNum;
+        server->send(buf, 2);
+        pingTime = Clock::now();
+        pinging = true;
+    }
+
+    m->hud.addTraffic(server->received, server->sent);
+    server->received = server->sent = 0;
 }
 
-void renderEntity(SDL_Renderer *renderer, Texture &texture, const Entity &entity, double lag) {
-    double dX = entity.getDX(), dY = entity.getDY();
-    texture.render(renderer, entity.x + lag * dX, entity.y + lag * dY, entity.w, entity.h, entity.orientation * 180/pi);
+int Game::getTickRate() {
+    return state.getTickRate();
 }
 
-void Game::render(double lag) {
-    background.render(m->renderer, 0, 0);
+// Entity n of to, moved alpha of the way there from where it was in
+// from (turning the short way round). Entities that jumped further than
+// they could have gone at speed (as balls do when they're served) are
+// just put there.
+static Entity interpolate(const EntityStore &from, const EntityStore &to, unsigned int n, double alpha, double seconds, double speed) {
+    Entity entity(to[n]);
+    if (n >= from.size())
+        return entity;
+
+    double dx = to.x[n] - from.x[n], dy = to.y[n] - from.y[n];
+    double reach = 2 * speed * seconds + 1;
+    if (dx * dx + dy * dy > reach * reach)
+        return entity;
+
+    entity.x = from.x[n] + alpha * dx;
+    entity.y = from.y[n] + alpha * dy;
+    entity.setOrientation(from.orientation[n] + alpha * remainder(to.orientation[n] - from.orientation[n], 2*pi));
+    return entity;
+}
+
+static void addEntity(RenderBatch &batch, const Entity &entity) {
+    batch.add(NULL, entity.x, entity.y, entity.w, entity.h, entity.getOrientation() * 180/pi);
+}
 
-    char buf[21]; // Max number of characters for a 64-bit int in base 10.
-    Texture score;
+void Game::renderScores(const SharedState &shown) {
+    GlyphAtlas &atlas = m->atlases[FONT_SQR][classic ? SIZE_48 : SIZE_32];
+    if (scoreLayouts.size() != shown.scores.size()) {
+        scoreLayouts.resize(shown.scores.size());
+        shownScores.clear();
+    }
+    for (unsigned int i = 0; i < shown.scores.size(); i++) {
+        if (i < shownScores.size() && shownScores[i] == shown.scores[i])
+            continue;
+        char buf[21]; // Max number of characters for a 64-bit int in base 10.
+        atlas.layout(itoa(shown.scores[i], buf, 21), scoreLayouts[i]);
+    }
+    shownScores = shown.scores;
 
     if (classic) {
-        score = Texture::fromText(m->renderer, m->fonts[FONT_SQR][SIZE_48], itoa(state.scores[0], buf, 21));
-        score.render(m->renderer, m->WIDTH/4 - score.w/2, 40);
-        score = Texture::fromText(m->renderer, m->fonts[FONT_SQR][SIZE_48], itoa(state.scores[1], buf, 21));
-        score.render(m->renderer, m->WIDTH*3/4 - score.w/2, 40);
-    } else {
-        int wallMult = state.boundaries.size() / state.scores.size();
-        for (unsigned int i = 0; i < state.scores.size(); i++) {
-            score = Texture::fromText(m->renderer, m->fonts[FONT_SQR][SIZE_32], itoa(state.scores[i], buf, 21), 0xaa, 0xaa, 0xaa);
-            Vector2 midpoint = (state.boundaries[(state.playerBoundaryOffset + i*wallMult) % state.boundaries.size()] +
-                                state.boundaries[(state.playerBoundaryOffset + i*wallMult-1) % state.boundaries.size()]) / 2;
-            double angle = pi/2 - (i*wallMult + state.playerBoundaryOffset) * 2*pi / state.boundaries.size();
-            Vector2 center(midpoint.x + 70 * cos(angle), midpoint.y - 70 * sin(angle));
-            double theta = pi/2 - angle;
-            if (fmod(theta + 90, 2*pi) > pi)
-                theta += pi;
-            score.render(m->renderer, center.x - score.w/2.0, center.y - score.h/2.0, theta * 180/pi);
-        }
+        atlas.render(m->renderer, scoreLayouts[0], m->WIDTH/4 - scoreLayouts[0].w/2, 40);
+        atlas.render(m->renderer, scoreLayouts[1], m->WIDTH*3/4 - scoreLayouts[1].w/2, 40);
+        return;
     }
 
-    for (auto p = state.players.begin(); p < state.players.end(); ++p) {
-        renderEntity(m->renderer, whiteTexture, *p, lag);
-        // Debugging points.
-        SDL_SetRenderDrawColor(m->renderer, 0, 0, 0xff, 0xff);
-        SDL_RenderDrawPoint(m->renderer, p->getVertices()[0].x,  p->getVertices()[0].y);
-        SDL_SetRenderDrawColor(m->renderer, 0xff, 0, 0, 0xff);
-        SDL_RenderDrawPoint(m->renderer, p->getVertices()[1].x,  p->getVertices()[1].y);
-        SDL_SetRenderDrawColor(m->renderer, 0, 0xff, 0, 0);
-        SDL_RenderDrawPoint(m->renderer, p->getVertices()[2].x,  p->getVertices()[2].y);
+    const ArenaGeometry &arena = *shown.geometry;
+    atlas.setColorMod(0xaa, 0xaa, 0xaa);
+    for (unsigned int i = 0; i < shown.scores.size(); i++) {
+        const GlyphAtlas::Layout &score = scoreLayouts[i];
+        int edge = arena.playerEdges[i];
+        Vector2 midpoint = arena.starts[edge] + arena.edges[edge] / 2;
+        double angle = pi/2 - edge * 2*pi / shown.boundaries.size();
+        Vector2 center(midpoint.x + 70 * cos(angle), midpoint.y - 70 * sin(angle));
+        double theta = pi/2 - angle;
+        if (fmod(theta + 90, 2*pi) > pi)
+            theta += pi;
+        atlas.render(m->renderer, score, center.x - score.w/2.0, center.y - score.h/2.0, theta * 180/pi);
+    }
+    atlas.setColorMod(0xff, 0xff, 0xff);
+}
+
+// Only draws from the snapshots (and what's only touched on this
+// thread), since update() may be running at the same time.
+void Game::render() {
+    if (failed) {
+        errorScreen(failure.c_str());
+        return;
+    }
+
+    if (snapshots.fresh()) {
+        previous = snapshots.front();
+        snapshots.update();
+    }
+    const SharedState &shown = snapshots.front().state, &from = previous.state;
+
+    // Drawn a snapshot behind, so that there's always a newer one to
+    // move towards (until the simulation falls behind), taking as long
+    // to get there as the snapshots were apart, however many ticks that
+    // was.
+    double seconds = std::chrono::duration<double>(snapshots.front().time - previous.time).count();
+    double since = std::chrono::duration<double>(m->now() - snapshots.front().time).count();
+    double alpha = seconds > 0 ? clamp(since / seconds, 0, 1) : 1;
+
+    background.render(m->renderer, 0, 0);
+    renderScores(shown);
+
+    // Paddles, their debugging points and balls all go in one batch.
+    static const SDL_Color pointColors[] = { { 0, 0, 0xff, 0xff }, { 0xff, 0, 0, 0xff }, { 0, 0xff, 0, 0xff } };
+    for (unsigned int i = 0; i < shown.players.size(); i++) {
+        Entity paddle = interpolate(from.players, shown.players, i, alpha, seconds, shown.getMaxSpeed(shown.balls.size() + i));
+        addEntity(batch, paddle);
+        Vector2 vertices[4];
+        paddle.getVertices(vertices);
+        for (int v = 0; v < 3; v++)
+            batch.add(NULL, (int)vertices[v].x, (int)vertices[v].y, 1, 1, 0, pointColors[v]);
     }
-    Entity ball(state.ball);
-    ball.orientation += lag * state.ballRotation;
-    renderEntity(m->renderer, whiteTexture, ball, lag);
+    for (unsigned int i = 0; i < shown.balls.size(); i++)
+        addEntity(batch, interpolate(from.balls, shown.balls, i, alpha, seconds, shown.getMaxSpeed(i)));
+    batch.render(m->renderer, whiteTexture);
 
     SDL_SetRenderDrawColor(m->renderer, 0xff, 0xff, 0xff, 0xff);
 
-    SDL_Point points[state.boundaries.size()+1];
-    for (unsigned int i = 0; i < state.boundaries.size(); i++) {
-        points[i].x = round(state.boundaries[i].x);
-        points[i].y = round(state.boundaries[i].y);
+    SDL_Point points[shown.boundaries.size()+1];
+    for (unsigned int i = 0; i < shown.boundaries.size(); i++) {
+        points[i].x = round(shown.boundaries[i].x);
+        points[i].y = round(shown.boundaries[i].y);
     }
 
-    points[state.boundaries.size()].x = round(state.boundaries[0].x);
-    points[state.boundaries.size()].y = round(state.boundaries[0].y);
+    points[shown.boundaries.size()].x = round(shown.boundaries[0].x);
+    points[shown.boundaries.size()].y = round(shown.boundaries[0].y);
 
-    SDL_RenderDrawLines(m->renderer, points, state.boundaries.size()+1);
+    SDL_RenderDrawLines(m->renderer, points, shown.boundaries.size()+1);
 
     SDL_SetRenderDrawBlendMode(m->renderer, SDL_BLENDMODE_BLEND);
-    overlay.render(m->renderer, 0, 0);
+    overlay->render(m->renderer, 0, 0);
     SDL_SetRenderDrawBlendMode(m->renderer, SDL_BLENDMODE_NONE);
 }
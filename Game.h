@@ -2,41 +2,90 @@
 #ifndef PING_GAME_H
 #define PING_GAME_H
 
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
 #include <vector>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_net.h>
 #include "GameState.h"
 #include "StateListener.h"
 #include "Texture.h"
+#include "GlyphAtlas.h"
+#include "RenderBatch.h"
 #include "SharedState.h"
 #include "PaddleInput.h"
 #include "Socket.h"
+#include "TripleBuffer.h"
 
 class Game: public GameState, public StateListener {
 public:
-    Game(GameManager *m, std::vector<PaddleInput *> inputs, int wallsPerPlayer, bool classic=false, bool demo=false);
+    Game(GameManager *m, std::vector<PaddleInput *> inputs, int wallsPerPlayer, bool classic=false, bool demo=false, int numBalls=1);
     Game(GameManager *m, PaddleInput *input, const char *host);
     ~Game();
 
     void onBounce();
     void onHit();
     void update();
-    void render(double lag);
+    int getTickRate();
+    void render();
+    // For scripted runs (see RenderScript): seeds the state and serves
+    // its balls again, so that the same seed always plays out the same.
+    void seed(unsigned int seed);
 
 private:
+    typedef std::chrono::steady_clock Clock;
+
+    // The state as of a tick, and when that tick was.
+    struct Snapshot {
+        SharedState state;
+        Clock::time_point time;
+    };
+
     static Texture whiteTexture;
+    // Overlays, by the boundaries of the arenas they mask (games keep
+    // theirs alive if they're dropped from here).
+    static const unsigned int MAX_OVERLAYS = 8;
+    static std::map<std::vector<double>, std::shared_ptr<Texture>> overlays;
+    static void maskOverlay(SDL_Surface *surface, const ArenaGeometry &arena, Uint32 color);
 
-    Texture background, overlay;
+    Texture background;
+    std::shared_ptr<Texture> overlay;
+    // Scores are only laid out again when they change.
+    std::vector<int> shownScores;
+    std::vector<GlyphAtlas::Layout> scoreLayouts;
+    // Reused from frame to frame, to keep its buffers.
+    RenderBatch batch;
     SharedState state;
+    // update() publishes a snapshot every tick, and render() draws
+    // between the last two it's seen (the older of which it keeps in
+    // previous), a snapshot behind.
+    TripleBuffer<Snapshot> snapshots;
+    Snapshot previous;
     std::vector<PaddleInput *> inputs;
     Socket *server;
+    // Set by update() when the connection fails, so that render() can
+    // show the error screen (which has to be made on the main thread).
+    std::atomic<bool> failed;
+    std::string failure;
+    // Servers are pinged every PING_INTERVAL milliseconds, for PerfHUD.
+    static const int PING_INTERVAL = 500;
+    bool pinging;
+    char pingNum;
+    Clock::time_point pingTime;
     bool networked;
     int playerNum;
     bool classic, demo;
 
     void setupStatic();
     void setupTextures();
+    void publish();
+    void publishFirst();
+    void renderScores(const SharedState &shown);
     void errorScreen(const char *msg);
+    void fail(const char *msg);
     void handleInput();
 };
 
@@ -1,19 +1,57 @@
+#include <chrono>
 #include <stdlib.h>
+#include <string.h>
+#include <thread>
 #include <time.h>
 #include "GameManager.h"
+#include "RenderScript.h"
 #include "utility.h"
 
+typedef std::chrono::steady_clock Clock;
+
 const int GameManager::fontSizes[] = { 8, 12, 16, 24, 32, 48, 64 };
 
+// headless is false by default (see GameManager.h).
+GameManager::GameManager(bool headless)
+    : headless(headless), window(NULL), screen(NULL), renderer(NULL), bounceSound(NULL), hitSound(NULL) {}
+
+std::chrono::steady_clock::time_point GameManager::now() const {
+    return headless ? headlessTime : Clock::now();
+}
+
+void GameManager::advance(double seconds) {
+    headlessTime += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
 bool GameManager::init() {
     srand(time(NULL));
 
-    if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
+    if (headless) {
+        // Set before SDL_Init(), so that nothing needs a display or a
+        // sound card.
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+        if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_TIMER) != 0)
+            return SDLerror("SDL_Init");
+    } else if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
         return SDLerror("SDL_Init");
 
     if (TTF_Init() != 0)
         return SDLerror("TTF_Init");
 
+    if (headless) {
+        screen = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (screen == NULL)
+            return SDLerror("SDL_CreateRGBSurfaceWithFormat");
+
+        renderer = SDL_CreateSoftwareRenderer(screen);
+        if (renderer == NULL)
+            return SDLerror("SDL_CreateSoftwareRenderer");
+
+        headlessTime = Clock::time_point();
+        return loadFonts();
+    }
+
     if (Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, 2, 2048) != 0)
         return SDLerror("Mix_OpenAudio");
 
@@ -35,6 +73,22 @@ bool GameManager::init() {
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
     SDL_RenderSetLogicalSize(renderer, WIDTH, HEIGHT);
 
+    if (!loadFonts())
+        return false;
+
+    bounceSound = Mix_LoadWAV("boop.wav");
+    hitSound = Mix_LoadWAV("hit.wav");
+    if (bounceSound == NULL || hitSound == NULL)
+        return SDLerror("Mix_LoadWAV");
+
+    Mix_AllocateChannels(16);
+
+    pushState(new TitleScreen(this));
+
+    return true;
+}
+
+bool GameManager::loadFonts() {
     for (int i = 0; i < SIZE_END; i++) {
         fonts[FONT_RND][i] = TTF_OpenFont("kenpixel.ttf", fontSizes[i]);
         if (fonts[FONT_RND][i] == NULL)
@@ -47,35 +101,37 @@ bool GameManager::init() {
             return SDLerror("TTF_OpenFont");
     }
 
-    bounceSound = Mix_LoadWAV("boop.wav");
-    hitSound = Mix_LoadWAV("hit.wav");
-    if (bounceSound == NULL || hitSound == NULL)
-        return SDLerror("Mix_LoadWAV");
-
-    Mix_AllocateChannels(16);
-
-    pushState(new TitleScreen(this));
+    for (int i = 0; i < FONT_END; i++) {
+        for (int j = 0; j < SIZE_END; j++) {
+            if (!atlases[i][j].load(renderer, fonts[i][j]))
+                return false;
+        }
+    }
 
     return true;
 }
 
 GameState *GameManager::getState() {
+    std::lock_guard<std::recursive_mutex> lock(stateMutex);
     while (!stateStack.back()->valid)
         revertState();
     return stateStack.back();
 }
 
 void GameManager::pushState(GameState *state) {
+    std::lock_guard<std::recursive_mutex> lock(stateMutex);
     stateStack.push_back(state);
 }
 
 GameState *GameManager::popState() {
+    std::lock_guard<std::recursive_mutex> lock(stateMutex);
     GameState *top = stateStack.back();
     stateStack.pop_back();
     return top;
 }
 
 void GameManager::revertState() {
+    std::lock_guard<std::recursive_mutex> lock(stateMutex);
     delete popState();
 }
 
@@ -89,11 +145,14 @@ void GameManager::handleEvents() {
     // in, for example, an unwanted initial character in a textbox
     // (this happens with DevConsole, which is created by TitleScreen
     // after the backtick key is pressed).
+    std::lock_guard<std::recursive_mutex> lock(stateMutex);
     GameState *state = getState();
 
     while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT)
             running = false;
+        else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3)
+            hud.visible = !hud.visible;
         else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE && stateStack.size() > 1) {
             revertState();
             state = getState();
@@ -102,13 +161,53 @@ void GameManager::handleEvents() {
     }
 }
 
-void GameManager::render(double lag) {
+// Updates the current state on its own thread, so that a slow frame
+// (or a long wait for vsync) doesn't hold up ticks. Ticks are due at
+// fixed times, rather than a fixed time after each other, so they
+// don't drift; a late one is made up for by an early next one.
+void GameManager::simulate() {
+    Clock::time_point next = Clock::now();
+
+    while (running) {
+        int tickRate;
+        {
+            std::lock_guard<std::recursive_mutex> lock(stateMutex);
+            GameState *state = stateStack.back();
+            Clock::time_point start = Clock::now();
+            if (state->valid)
+                state->update();
+            hud.addTick(std::chrono::duration<double>(Clock::now() - start).count());
+            // The current state decides how often it's updated (a
+            // networked game goes at the server's rate).
+            tickRate = state->getTickRate();
+        }
+
+        next += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / tickRate));
+        // After a long stall (say, the machine sleeping), it starts
+        // again from now, rather than rushing through what it missed.
+        Clock::time_point now = Clock::now();
+        if (now - next > std::chrono::seconds(1))
+            next = now;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+// The HUD's own time is left out of the frame's render time.
+void GameManager::render() {
+    Clock::time_point start = Clock::now();
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xff);
     SDL_RenderClear(renderer);
 
-    getState()->render(lag);
+    getState()->render();
+    Clock::time_point rendered = Clock::now();
 
+    if (hud.visible)
+        hud.render(renderer, atlases[FONT_SQR][SIZE_12]);
+
+    Clock::time_point presenting = Clock::now();
     SDL_RenderPresent(renderer);
+    hud.addFrame(std::chrono::duration<double>(rendered - start).count(),
+                 std::chrono::duration<double>(Clock::now() - presenting).count());
 }
 
 int GameManager::run() {
@@ -117,21 +216,12 @@ int GameManager::run() {
     if (!init())
         return 1;
 
-    const double MS_PER_UPDATE = 1000.0 / 60.0;
-    Uint32 last, time = SDL_GetTicks();
-    double lag = 0;
-
+    std::thread simulation(&GameManager::simulate, this);
     while (running) {
         handleEvents();
-        while (lag >= MS_PER_UPDATE) {
-            getState()->update();
-            lag -= MS_PER_UPDATE;
-        }
-        render(lag / MS_PER_UPDATE);
-        last = time;
-        time = SDL_GetTicks();
-        lag += time - last;
+        render();
     }
+    simulation.join();
 
     cleanup();
 
@@ -141,6 +231,7 @@ int GameManager::run() {
 void GameManager::cleanup() {
     for (std::vector<GameState *>::reverse_iterator it = stateStack.rbegin(); it != stateStack.rend(); it++)
         delete *it;
+    stateStack.clear();
 
     Mix_FreeChunk(hitSound);
     Mix_FreeChunk(bounceSound);
@@ -152,15 +243,21 @@ void GameManager::cleanup() {
     }
 
     SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-
-    SDLNet_Quit();
-    Mix_CloseAudio();
+    if (headless) {
+        SDL_FreeSurface(screen);
+    } else {
+        SDL_DestroyWindow(window);
+        SDLNet_Quit();
+        Mix_CloseAudio();
+    }
     TTF_Quit();
     SDL_Quit();
 }
 
 int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0)
+        return runHeadless(argc - 2, argv + 2);
+
     GameManager manager;
     return manager.run();
 }
@@ -2,10 +2,15 @@
 #ifndef PING_GAME_MANAGER_H
 #define PING_GAME_MANAGER_H
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <vector>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <SDL2/SDL_mixer.h>
+#include "GlyphAtlas.h"
+#include "PerfHUD.h"
 #include "TitleScreen.h"
 #include "Game.h"
 
@@ -19,11 +24,31 @@ public:
 
     static const int fontSizes[];
 
+    // Headless managers have no window, vsync or sound: they render in
+    // software to screen, with SDL's dummy video and audio drivers, and
+    // their time only moves with advance() (see RenderScript).
+    bool headless;
     SDL_Window *window;
+    SDL_Surface *screen;
     SDL_Renderer *renderer;
     TTF_Font *fonts[FONT_END][SIZE_END];
+    // For text that changes often (like scores).
+    GlyphAtlas atlases[FONT_END][SIZE_END];
     Mix_Chunk *bounceSound, *hitSound;
-    bool running;
+    PerfHUD hud;
+    std::atomic<bool> running;
+
+    GameManager(bool headless=false);
+
+    // What states go by for the time (which, headless, is only moved on
+    // by advance()).
+    std::chrono::steady_clock::time_point now() const;
+    void advance(double seconds);
+
+    // run() calls these around its loop; headless callers, which have
+    // no loop, call them directly.
+    bool init();
+    void cleanup();
 
     GameState *getState();
     void pushState(GameState *state);
@@ -33,11 +58,18 @@ public:
 
 private:
     std::vector<GameState *> stateStack;
+    // Held while the stack changes, and while a state handles events or
+    // updates, so that the main thread and the simulation thread take
+    // turns with states. Rendering doesn't hold it; states only change
+    // what they draw from on the main thread, or pass it over (see
+    // Game's snapshots). States are only deleted on the main thread.
+    std::recursive_mutex stateMutex;
+    std::chrono::steady_clock::time_point headlessTime;
 
-    bool init();
     void handleEvents();
-    void render(double lag);
-    void cleanup();
+    void simulate();
+    void render();
+    bool loadFonts();
 };
 
 #endif
@@ -2,23 +2,27 @@
 #ifndef PING_GAME_STATE_H
 #define PING_GAME_STATE_H
 
+#include <atomic>
 #include <SDL2/SDL.h>
 
 // Ugh!
 class GameManager;
 
+// update() runs on GameManager's simulation thread, and everything
+// else on the main thread (see GameManager::run()).
 class GameState {
  public:
-    bool valid;
+    std::atomic<bool> valid;
 
     GameState(GameManager *m) : valid(true), m(m) {}
     virtual ~GameState() {}
     virtual void handleEvent(SDL_Event &event) {}
     virtual void update() {}
-    virtual void render() {}
-    virtual void render(double lag) {
-        render();
+    // How many times a second update() should be called.
+    virtual int getTickRate() {
+        return 60;
     }
+    virtual void render() {}
 
  protected:
     GameManager *m;
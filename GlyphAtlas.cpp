@@ -0,0 +1,94 @@
+#include <algorithm>
+#include "GlyphAtlas.h"
+#include "utility.h"
+
+GlyphAtlas::GlyphAtlas() : color(RenderBatch::WHITE), height(0) {
+    for (int g = 0; g < NUM_GLYPHS; g++) {
+        glyphs[g].x = glyphs[g].y = glyphs[g].w = glyphs[g].h = 0;
+        offsets[g] = advances[g] = 0;
+    }
+}
+
+bool GlyphAtlas::load(SDL_Renderer *renderer, TTF_Font *font) {
+    SDL_Color white = { 0xff, 0xff, 0xff, 0xff };
+    SDL_Surface *surfaces[NUM_GLYPHS];
+    height = TTF_FontHeight(font);
+
+    // Glyphs are rendered without any horizontal padding, so each is
+    // placed by its minimum x, and the pen moves on by its advance.
+    int x = 0, y = 0, w = 0;
+    for (int g = 0; g < NUM_GLYPHS; g++) {
+        int minX, advance;
+        surfaces[g] = TTF_RenderGlyph_Solid(font, FIRST_GLYPH + g, white);
+        if (surfaces[g] == NULL || TTF_GlyphMetrics(font, FIRST_GLYPH + g, &minX, NULL, NULL, NULL, &advance) != 0) {
+            for (int s = 0; s <= g; s++)
+                SDL_FreeSurface(surfaces[s]);
+            return SDLerror("TTF_RenderGlyph_Solid");
+        }
+
+        if (x + surfaces[g]->w > MAX_WIDTH) {
+            x = 0;
+            y += height;
+        }
+        SDL_Rect glyph = { x, y, surfaces[g]->w, surfaces[g]->h };
+        glyphs[g] = glyph;
+        offsets[g] = minX;
+        advances[g] = advance;
+        x += glyph.w;
+        w = std::max(w, x);
+    }
+
+    SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, std::max(w, 1), y + height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (atlas == NULL) {
+        for (int g = 0; g < NUM_GLYPHS; g++)
+            SDL_FreeSurface(surfaces[g]);
+        return SDLerror("SDL_CreateRGBSurfaceWithFormat");
+    }
+
+    // Solid glyphs are color-keyed, so only their pixels are copied
+    // over the transparent atlas.
+    SDL_FillRect(atlas, NULL, 0);
+    for (int g = 0; g < NUM_GLYPHS; g++) {
+        SDL_BlitSurface(surfaces[g], NULL, atlas, &glyphs[g]);
+        SDL_FreeSurface(surfaces[g]);
+    }
+
+    texture = Texture::fromSurface(renderer, atlas);
+    SDL_FreeSurface(atlas);
+    return !texture.empty();
+}
+
+void GlyphAtlas::layout(const char *text, Layout &layout) const {
+    layout.src.clear();
+    layout.dst.clear();
+    int x = 0;
+    for (const char *c = text; *c != '\0'; c++) {
+        int g = *c - FIRST_GLYPH;
+        if (g < 0 || g >= NUM_GLYPHS)
+            continue;
+
+        if (glyphs[g].w > 0) {
+            SDL_Rect dst = { x + offsets[g], 0, glyphs[g].w, glyphs[g].h };
+            layout.src.push_back(glyphs[g]);
+            layout.dst.push_back(dst);
+        }
+        x += advances[g];
+    }
+    layout.w = x;
+    layout.h = height;
+}
+
+void GlyphAtlas::setColorMod(Uint8 r, Uint8 g, Uint8 b) {
+    SDL_Color mod = { r, g, b, 0xff };
+    color = mod;
+}
+
+// angle is 0 by default (see GlyphAtlas.h).
+void GlyphAtlas::render(SDL_Renderer *renderer, const Layout &layout, int x, int y, double angle) {
+    // Each glyph turns about the center of the whole text.
+    for (unsigned int i = 0; i < layout.src.size(); i++) {
+        const SDL_Rect &src = layout.src[i], &dst = layout.dst[i];
+        batch.add(&src, x + dst.x, y + dst.y, dst.w, dst.h, angle, layout.w/2 - dst.x, layout.h/2 - dst.y, color);
+    }
+    batch.render(renderer, texture);
+}
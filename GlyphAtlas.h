@@ -0,0 +1,53 @@
+// -*- c++ -*-
+#ifndef PING_GLYPH_ATLAS_H
+#define PING_GLYPH_ATLAS_H
+
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include "RenderBatch.h"
+#include "Texture.h"
+
+// Every printable ASCII glyph of one font, rasterized once (in white)
+// into one texture. Text is laid out into a list of glyph quads, which
+// can be kept for as long as the text doesn't change, and drawn from
+// the atlas in one batch, so there's no rasterizing or uploading per
+// frame.
+class GlyphAtlas {
+public:
+    static const char FIRST_GLYPH = ' ', LAST_GLYPH = '~';
+
+    struct Layout {
+        // One pair of rects per glyph drawn: where it is in the atlas,
+        // and where it goes relative to the text's top left.
+        std::vector<SDL_Rect> src, dst;
+        int w, h;
+    };
+
+    GlyphAtlas();
+
+    // Returns false if the glyphs couldn't be rendered.
+    bool load(SDL_Renderer *renderer, TTF_Font *font);
+
+    // Characters outside the atlas are skipped, taking up no space.
+    void layout(const char *text, Layout &layout) const;
+
+    void setColorMod(Uint8 r, Uint8 g, Uint8 b);
+    // angle is in degrees, about the text's center.
+    void render(SDL_Renderer *renderer, const Layout &layout, int x, int y, double angle=0);
+
+private:
+    static const int NUM_GLYPHS = LAST_GLYPH - FIRST_GLYPH + 1;
+    // Rows of glyphs are wrapped at this width, to stay within the
+    // texture sizes renderers support.
+    static const int MAX_WIDTH = 1024;
+
+    Texture texture;
+    RenderBatch batch;
+    SDL_Color color;
+    SDL_Rect glyphs[NUM_GLYPHS];
+    int offsets[NUM_GLYPHS], advances[NUM_GLYPHS];
+    int height;
+};
+
+#endif
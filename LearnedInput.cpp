@@ -0,0 +1,49 @@
+#include "LearnedInput.h"
+#include "utility.h"
+
+// Distances are in units of DISTANCE and speeds of SPEED (both scaled
+// with the arena), which keeps most features within [-1, 1].
+static const double DISTANCE = 400;
+static const double SPEED = 600;
+
+LearnedInput::LearnedInput(const LearnedModel &model): model(&model), tracker(AIInput::HARD) {}
+
+int LearnedInput::update(SharedState &state, int playerNum) {
+    return model->play(getFeatures(state, playerNum));
+}
+
+LearnedModel::Features LearnedInput::getFeatures(const SharedState &state, int playerNum) {
+    Vector2 dir(state.players.cosTheta[playerNum], state.players.sinTheta[playerNum]);
+    Vector2 normal = state.geometry->normals[state.geometry->playerEdges[playerNum]];
+    Vector2 vertices[4];
+    state.players.getVertices(playerNum, vertices);
+    Vector2 playerMid((vertices[1] + vertices[2]) / 2);
+    int ballNum = AIInput::chooseBall(state, playerMid);
+    Vector2 ballMid(state.balls.getCenter(ballNum));
+    Vector2 velocity(state.balls.getDX(ballNum), state.balls.getDY(ballNum));
+    double playerPos = playerMid * dir;
+
+    // As with HARD, a ball that won't reach the paddle is treated as
+    // being right in front of it.
+    double elapsed = tracker.track(state, playerNum, ballNum);
+    double offset = 0, time = 1.0 / 60;
+    if (tracker.prediction.found) {
+        offset = tracker.prediction.intercept * dir - playerPos;
+        time = tracker.prediction.time - elapsed;
+    }
+
+    double distance = DISTANCE * state.scale, speed = SPEED * state.scale;
+    LearnedModel::Features features = {{
+        offset / time / speed,
+        state.players.v[playerNum] / speed,
+        offset / distance,
+        time,
+        (ballMid * dir - playerPos) / distance,
+        (ballMid - playerMid) * normal / distance,
+        velocity * dir / speed,
+        velocity * normal / speed,
+    }};
+    for (double &feature : features)
+        feature = clamp(feature, -1, 1);
+    return features;
+}
@@ -0,0 +1,27 @@
+// -*- c++ -*-
+#ifndef PING_LEARNED_INPUT_H
+#define PING_LEARNED_INPUT_H
+
+#include "PaddleInput.h"
+#include "AIInput.h"
+#include "LearnedModel.h"
+
+// Plays a paddle with a LearnedModel. The model sees the ball AIInput
+// would play, mostly in terms of the paddle: how far it is along and in
+// front of the paddle, how fast it's going each way, and where and when
+// it'll reach the paddle (tracked the way HARD does it).
+class LearnedInput: public PaddleInput {
+public:
+    // model isn't copied, so it has to outlive this.
+    LearnedInput(const LearnedModel &model);
+    int update(SharedState &state, int playerNum);
+
+    // The model's features for player, each clamped to [-1, 1].
+    LearnedModel::Features getFeatures(const SharedState &state, int playerNum);
+
+private:
+    const LearnedModel *model;
+    AIInput tracker;
+};
+
+#endif
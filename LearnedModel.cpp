@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <fstream>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "LearnedModel.h"
+#include "simd.h"
+#include "utility.h"
+
+static const char *MODEL_HEADER = "ping-model";
+static const int MODEL_VERSION = 1;
+
+#ifdef PING_SIMD
+static_assert(LearnedModel::NUM_HIDDEN % SIMD_INT_WIDTH == 0, "hidden units must fill whole vectors");
+#endif
+
+// Rounds half away from zero, like lround(), but without the call.
+static int roundToInt(double x) {
+    return x >= 0 ? (int)(x + .5) : -(int)(.5 - x);
+}
+
+// Rounds x / scale to the nearest 8-bit value.
+static int quantizeValue(double x, double scale) {
+    return roundToInt(clamp(x / scale, -127, 127));
+}
+
+LearnedModel::LearnedModel() {
+    memset(hidden, 0, sizeof(hidden));
+    memset(hiddenBias, 0, sizeof(hiddenBias));
+    memset(output, 0, sizeof(output));
+    memset(outputBias, 0, sizeof(outputBias));
+    quantize(std::vector<Features>());
+}
+
+void LearnedModel::randomize(std::minstd_rand &rng, double sigma) {
+    std::normal_distribution<double> noise(0, sigma);
+    for (int h = 0; h < NUM_HIDDEN; h++) {
+        for (int f = 0; f < NUM_FEATURES; f++)
+            hidden[h][f] += noise(rng);
+        hiddenBias[h] += noise(rng);
+    }
+    for (int m = 0; m < NUM_MOVES; m++) {
+        for (int h = 0; h < NUM_HIDDEN; h++)
+            output[m][h] += noise(rng);
+        outputBias[m] += noise(rng);
+    }
+}
+
+// activations is NULL by default (see LearnedModel.h).
+void LearnedModel::evaluate(const Features &features, double scores[NUM_MOVES], double activations[NUM_HIDDEN]) const {
+    double a[NUM_HIDDEN];
+    for (int h = 0; h < NUM_HIDDEN; h++) {
+        double sum = hiddenBias[h];
+        for (int f = 0; f < NUM_FEATURES; f++)
+            sum += hidden[h][f] * features[f];
+        a[h] = std::max(sum, 0.0);
+        if (activations != NULL)
+            activations[h] = a[h];
+    }
+
+    for (int m = 0; m < NUM_MOVES; m++) {
+        scores[m] = outputBias[m];
+        for (int h = 0; h < NUM_HIDDEN; h++)
+            scores[m] += output[m][h] * a[h];
+    }
+}
+
+void LearnedModel::train(const Features &features, int move, double rate) {
+    double scores[NUM_MOVES], a[NUM_HIDDEN];
+    evaluate(features, scores, a);
+
+    // The gradient of the loss with respect to each score is its
+    // probability, less 1 for the right move.
+    double top = *std::max_element(scores, scores + NUM_MOVES), total = 0;
+    double gradients[NUM_MOVES];
+    for (int m = 0; m < NUM_MOVES; m++) {
+        gradients[m] = exp(scores[m] - top);
+        total += gradients[m];
+    }
+    for (int m = 0; m < NUM_MOVES; m++)
+        gradients[m] = gradients[m] / total - (m == move + 1);
+
+    for (int h = 0; h < NUM_HIDDEN; h++) {
+        if (a[h] <= 0)
+            continue;
+        double gradient = 0;
+        for (int m = 0; m < NUM_MOVES; m++)
+            gradient += gradients[m] * output[m][h];
+        for (int f = 0; f < NUM_FEATURES; f++)
+            hidden[h][f] -= rate * gradient * features[f];
+        hiddenBias[h] -= rate * gradient;
+    }
+
+    for (int m = 0; m < NUM_MOVES; m++) {
+        for (int h = 0; h < NUM_HIDDEN; h++)
+            output[m][h] -= rate * gradients[m] * a[h];
+        outputBias[m] -= rate * gradients[m];
+    }
+}
+
+// A feature of 1 is quantized to 127, so a hidden sum of 1 is worth
+// hiddenScale / 127, and an output sum of 1 activationScale *
+// outputScale.
+void LearnedModel::quantize(const std::vector<Features> &samples) {
+    double largest = 0;
+    for (int h = 0; h < NUM_HIDDEN; h++) {
+        for (int f = 0; f < NUM_FEATURES; f++)
+            largest = std::max(largest, fabs(hidden[h][f]));
+    }
+    hiddenScale = largest > 0 ? largest / 127 : 1;
+
+    largest = 0;
+    for (int m = 0; m < NUM_MOVES; m++) {
+        for (int h = 0; h < NUM_HIDDEN; h++)
+            largest = std::max(largest, fabs(output[m][h]));
+    }
+    outputScale = largest > 0 ? largest / 127 : 1;
+
+    largest = 0;
+    for (const Features &features : samples) {
+        double scores[NUM_MOVES], a[NUM_HIDDEN];
+        evaluate(features, scores, a);
+        largest = std::max(largest, *std::max_element(a, a + NUM_HIDDEN));
+    }
+    activationScale = largest > 0 ? largest / 127 : 1;
+
+    for (int h = 0; h < NUM_HIDDEN; h++) {
+        for (int f = 0; f < NUM_FEATURES; f++)
+            hiddenWeights[f][h] = quantizeValue(hidden[h][f], hiddenScale);
+        hiddenBiases[h] = roundToInt(hiddenBias[h] / (hiddenScale / 127));
+    }
+    for (int m = 0; m < NUM_MOVES; m++) {
+        for (int h = 0; h < NUM_HIDDEN; h++)
+            outputWeights[m][h] = quantizeValue(output[m][h], outputScale);
+        outputBiases[m] = roundToInt(outputBias[m] / (activationScale * outputScale));
+    }
+}
+
+void LearnedModel::dequantize() {
+    for (int h = 0; h < NUM_HIDDEN; h++) {
+        for (int f = 0; f < NUM_FEATURES; f++)
+            hidden[h][f] = hiddenWeights[f][h] * hiddenScale;
+        hiddenBias[h] = hiddenBiases[h] * hiddenScale / 127;
+    }
+    for (int m = 0; m < NUM_MOVES; m++) {
+        for (int h = 0; h < NUM_HIDDEN; h++)
+            output[m][h] = outputWeights[m][h] * outputScale;
+        outputBias[m] = outputBiases[m] * activationScale * outputScale;
+    }
+}
+
+int LearnedModel::play(const Features &features) const {
+    int x[NUM_FEATURES], sums[NUM_HIDDEN], a[NUM_HIDDEN];
+    for (int f = 0; f < NUM_FEATURES; f++)
+        x[f] = roundToInt(clamp(features[f], -1, 1) * 127);
+
+#ifdef PING_SIMD
+    for (int h = 0; h < NUM_HIDDEN; h += SIMD_INT_WIDTH) {
+        intv sum = loadiv(&hiddenBiases[h]);
+        for (int f = 0; f < NUM_FEATURES; f++)
+            sum += broadcastiv(x[f]) * loadiv(&hiddenWeights[f][h]);
+        storeiv(&sums[h], sum);
+    }
+#else
+    for (int h = 0; h < NUM_HIDDEN; h++) {
+        sums[h] = hiddenBiases[h];
+        for (int f = 0; f < NUM_FEATURES; f++)
+            sums[h] += x[f] * hiddenWeights[f][h];
+    }
+#endif
+
+    const double requantize = hiddenScale / 127 / activationScale;
+    for (int h = 0; h < NUM_HIDDEN; h++)
+        a[h] = sums[h] > 0 ? std::min(roundToInt(sums[h] * requantize), 127) : 0;
+
+    int best = 0, bestScore = 0;
+    for (int m = 0; m < NUM_MOVES; m++) {
+        int score = outputBiases[m];
+#ifdef PING_SIMD
+        intv sum = broadcastiv(0);
+        for (int h = 0; h < NUM_HIDDEN; h += SIMD_INT_WIDTH)
+            sum += loadiv(&a[h]) * loadiv(&outputWeights[m][h]);
+        for (int lane = 0; lane < SIMD_INT_WIDTH; lane++)
+            score += sum[lane];
+#else
+        for (int h = 0; h < NUM_HIDDEN; h++)
+            score += a[h] * outputWeights[m][h];
+#endif
+        if (m == 0 || score > bestScore) {
+            best = m;
+            bestScore = score;
+        }
+    }
+
+    return best - 1;
+}
+
+bool LearnedModel::load(const std::string &path) {
+    std::ifstream in(path);
+    std::string header;
+    int version, numFeatures, numHidden, numMoves;
+    if (!(in >> header >> version >> numFeatures >> numHidden >> numMoves) || header != MODEL_HEADER || version != MODEL_VERSION ||
+        numFeatures != NUM_FEATURES || numHidden != NUM_HIDDEN || numMoves != NUM_MOVES)
+        return false;
+
+    LearnedModel model;
+    in >> model.hiddenScale >> model.outputScale >> model.activationScale;
+    bool inRange = true;
+    for (int h = 0; h < NUM_HIDDEN; h++) {
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            in >> model.hiddenWeights[f][h];
+            inRange = inRange && abs(model.hiddenWeights[f][h]) <= 127;
+        }
+    }
+    for (int h = 0; h < NUM_HIDDEN; h++)
+        in >> model.hiddenBiases[h];
+    for (int m = 0; m < NUM_MOVES; m++) {
+        for (int h = 0; h < NUM_HIDDEN; h++) {
+            in >> model.outputWeights[m][h];
+            inRange = inRange && abs(model.outputWeights[m][h]) <= 127;
+        }
+    }
+    for (int m = 0; m < NUM_MOVES; m++)
+        in >> model.outputBiases[m];
+
+    if (!in || !inRange || !(model.hiddenScale > 0) || !(model.outputScale > 0) || !(model.activationScale > 0))
+        return false;
+
+    model.dequantize();
+    *this = model;
+    return true;
+}
+
+bool LearnedModel::save(const std::string &path) const {
+    std::ofstream out(path);
+    out.precision(17);
+    out << MODEL_HEADER << " " << MODEL_VERSION << std::endl
+        << NUM_FEATURES << " " << NUM_HIDDEN << " " << NUM_MOVES << std::endl
+        << hiddenScale << " " << outputScale << " " << activationScale << std::endl;
+    for (int h = 0; h < NUM_HIDDEN; h++) {
+        for (int f = 0; f < NUM_FEATURES; f++)
+            out << (f > 0 ? " " : "") << hiddenWeights[f][h];
+        out << std::endl;
+    }
+    for (int h = 0; h < NUM_HIDDEN; h++)
+        out << (h > 0 ? " " : "") << hiddenBiases[h];
+    out << std::endl;
+    for (int m = 0; m < NUM_MOVES; m++) {
+        for (int h = 0; h < NUM_HIDDEN; h++)
+            out << (h > 0 ? " " : "") << outputWeights[m][h];
+        out << std::endl;
+    }
+    for (int m = 0; m < NUM_MOVES; m++)
+        out << (m > 0 ? " " : "") << outputBiases[m];
+    out << std::endl;
+    return (bool)out;
+}
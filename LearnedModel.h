@@ -0,0 +1,69 @@
+// -*- c++ -*-
+#ifndef PING_LEARNED_MODEL_H
+#define PING_LEARNED_MODEL_H
+
+#include <array>
+#include <random>
+#include <string>
+#include <vector>
+
+// A tiny multilayer perceptron that picks a paddle's move from
+// LearnedInput's features: NUM_FEATURES inputs, one hidden layer of
+// NUM_HIDDEN ReLUs, and a score for each of the NUM_MOVES moves (-1, 0
+// and 1). It's trained in floating point (see ping-sim --train), but
+// played quantized: features, weights and hidden activations are 8-bit,
+// and the sums 32-bit, so that a move costs a few dozen vector
+// multiply-adds (see simd.h). Model files hold the quantized network.
+class LearnedModel {
+public:
+    static const int NUM_FEATURES = 8, NUM_HIDDEN = 16, NUM_MOVES = 3;
+    typedef std::array<double, NUM_FEATURES> Features;
+
+    // The floating-point network, which training works on. Features
+    // are expected to be in [-1, 1] (they're clamped when quantized).
+    double hidden[NUM_HIDDEN][NUM_FEATURES], hiddenBias[NUM_HIDDEN];
+    double output[NUM_MOVES][NUM_HIDDEN], outputBias[NUM_MOVES];
+
+    // All weights start at 0, so it needs randomize() (or load()) and
+    // quantize() before it's any use.
+    LearnedModel();
+
+    // Adds normally-distributed noise (with standard deviation sigma) to
+    // every weight.
+    void randomize(std::minstd_rand &rng, double sigma);
+
+    // The floating-point network's scores for each move, and (if
+    // activations isn't NULL) its hidden activations.
+    void evaluate(const Features &features, double scores[NUM_MOVES], double activations[NUM_HIDDEN]=NULL) const;
+    // One step of stochastic gradient descent on the cross-entropy of
+    // the softmax of the scores, towards move.
+    void train(const Features &features, int move, double rate);
+
+    // Rebuilds the quantized network from the floating-point one, with
+    // the hidden activations' range fitted to those of samples.
+    void quantize(const std::vector<Features> &samples);
+    // Runs the quantized network, returning its move.
+    int play(const Features &features) const;
+
+    // Files are text: a header, the scales, then the quantized weights.
+    // load() replaces both networks (the floating-point one with the
+    // quantized one's values), and returns false (leaving the model as
+    // it was) if the file can't be read or isn't a model.
+    bool load(const std::string &path);
+    bool save(const std::string &path) const;
+
+private:
+    // Weights are scaled so that the largest in each layer is 127, and
+    // stored widened to ints (transposed, for the hidden layer, so that
+    // each feature multiplies a contiguous row). Biases are in the units
+    // of their layer's sums.
+    int hiddenWeights[NUM_FEATURES][NUM_HIDDEN], hiddenBiases[NUM_HIDDEN];
+    int outputWeights[NUM_MOVES][NUM_HIDDEN], outputBiases[NUM_MOVES];
+    // The real values of a weight of 1 in each layer, and of a hidden
+    // activation of 1.
+    double hiddenScale, outputScale, activationScale;
+
+    void dequantize();
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include "PerfHUD.h"
+#include "Texture.h"
+
+const char *PerfHUD::SERIES_NAMES[] = { "render", "present", "update", "ticks", "uploads" };
+// Two frames at 60 Hz for the times.
+const double PerfHUD::SERIES_SCALES[] = { 1.0 / 30, 1.0 / 30, 1.0 / 30, 4, 8 };
+
+static const int PANEL_X = 10, PANEL_Y = 10, PADDING = 6, GRAPH_HEIGHT = 20;
+static const SDL_Color SERIES_COLORS[] = { { 0x44, 0xdd, 0x44, 0xff }, { 0x44, 0x88, 0xff, 0xff }, { 0xff, 0xaa, 0x22, 0xff },
+                                           { 0xdd, 0xdd, 0xdd, 0xff }, { 0xff, 0x44, 0x44, 0xff } };
+
+PerfHUD::PerfHUD()
+    : visible(false), next(0), hudSeconds(0), lastUploads(0), ticks(0), tickNanoseconds(0), networked(false), rtt(0), jitter(0),
+      receivedPerSecond(0), sentPerSecond(0), received(0), sent(0), trafficStart(0), labelTime(0) {
+    for (int s = 0; s < NUM_SERIES; s++)
+        std::fill(history[s], history[s] + HISTORY, 0.0);
+}
+
+void PerfHUD::addTick(double seconds) {
+    ticks++;
+    tickNanoseconds += (long)(seconds * 1e9);
+}
+
+void PerfHUD::addFrame(double renderSeconds, double presentSeconds) {
+    history[RENDER][next] = renderSeconds;
+    history[PRESENT][next] = presentSeconds;
+    history[UPDATE][next] = tickNanoseconds.exchange(0) / 1e9;
+    history[TICKS][next] = ticks.exchange(0);
+    history[UPLOADS][next] = Texture::uploads - lastUploads;
+    lastUploads = Texture::uploads;
+    next = (next + 1) % HISTORY;
+}
+
+void PerfHUD::addPing(double seconds) {
+    std::lock_guard<std::mutex> lock(networkMutex);
+    if (networked)
+        jitter += (fabs(seconds - rtt) - jitter) / 16;
+    rtt = seconds;
+    networked = true;
+}
+
+void PerfHUD::addTraffic(int received, int sent) {
+    std::lock_guard<std::mutex> lock(networkMutex);
+    this->received += received;
+    this->sent += sent;
+    Uint32 now = SDL_GetTicks();
+    if (now - trafficStart >= 1000) {
+        // Scaled to a second, in case the window ran over.
+        double seconds = trafficStart == 0 ? 1 : (now - trafficStart) / 1000.0;
+        receivedPerSecond = (int)(this->received / seconds);
+        sentPerSecond = (int)(this->sent / seconds);
+        this->received = this->sent = 0;
+        trafficStart = now;
+    }
+    networked = true;
+}
+
+void PerfHUD::resetNetwork() {
+    std::lock_guard<std::mutex> lock(networkMutex);
+    networked = false;
+    rtt = jitter = 0;
+    receivedPerSecond = sentPerSecond = received = sent = 0;
+    trafficStart = 0;
+}
+
+void PerfHUD::layoutLabels(GlyphAtlas &atlas) {
+    char buf[96];
+    for (int s = 0; s < NUM_SERIES; s++) {
+        double total = 0, most = 0;
+        for (int f = 0; f < HISTORY; f++) {
+            total += history[s][f];
+            most = std::max(most, history[s][f]);
+        }
+        if (s <= UPDATE)
+            snprintf(buf, sizeof(buf), "%-8s %5.2f ms (max %.1f)", SERIES_NAMES[s], total / HISTORY * 1000, most * 1000);
+        else
+            snprintf(buf, sizeof(buf), "%-8s %5.2f/frame (max %d)", SERIES_NAMES[s], total / HISTORY, (int)most);
+        atlas.layout(buf, labels[s]);
+    }
+
+    snprintf(buf, sizeof(buf), "hud      %5.2f ms", hudSeconds * 1000);
+    atlas.layout(buf, labels[NUM_SERIES]);
+
+    std::lock_guard<std::mutex> lock(networkMutex);
+    if (networked) {
+        snprintf(buf, sizeof(buf), "rtt %.1f ms, jitter %.1f ms, in %.1f kB/s, out %.1f kB/s", rtt * 1000, jitter * 1000,
+                 receivedPerSecond / 1000.0, sentPerSecond / 1000.0);
+    } else {
+        snprintf(buf, sizeof(buf), "not networked");
+    }
+    atlas.layout(buf, labels[NUM_SERIES + 1]);
+}
+
+void PerfHUD::render(SDL_Renderer *renderer, GlyphAtlas &atlas) {
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    Uint32 now = SDL_GetTicks();
+    if (labelTime == 0 || now - labelTime >= LABEL_INTERVAL) {
+        layoutLabels(atlas);
+        labelTime = now;
+    }
+
+    // Graphs go to the right of the widest label.
+    int labelWidth = 0;
+    for (int s = 0; s < NUM_SERIES; s++)
+        labelWidth = std::max(labelWidth, labels[s].w);
+    int textHeight = labels[0].h, rowHeight = std::max(GRAPH_HEIGHT, textHeight) + PADDING;
+    int graphX = PANEL_X + 2*PADDING + labelWidth;
+    int width = std::max(labelWidth + PADDING + HISTORY, std::max(labels[NUM_SERIES].w, labels[NUM_SERIES + 1].w));
+    SDL_Rect panel = { PANEL_X, PANEL_Y, width + 2*PADDING, NUM_SERIES * rowHeight + 2 * textHeight + 2*PADDING };
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xcc);
+    SDL_RenderFillRect(renderer, &panel);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    for (int s = 0; s < NUM_SERIES; s++) {
+        int y = PANEL_Y + PADDING + s * rowHeight;
+        atlas.render(renderer, labels[s], PANEL_X + PADDING, y + (GRAPH_HEIGHT - labels[s].h) / 2);
+
+        // Oldest on the left; each frame's bar rises from the bottom.
+        bars.clear();
+        for (int f = 0; f < HISTORY; f++) {
+            double value = history[s][(next + f) % HISTORY];
+            int h = std::min(GRAPH_HEIGHT, (int)ceil(value / SERIES_SCALES[s] * GRAPH_HEIGHT));
+            if (h > 0) {
+                SDL_Rect bar = { graphX + f, y + GRAPH_HEIGHT - h, 1, h };
+                bars.push_back(bar);
+            }
+        }
+        const SDL_Color &color = SERIES_COLORS[s];
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        SDL_RenderFillRects(renderer, bars.data(), bars.size());
+
+        // The middle of the time graphs is a 60 Hz frame.
+        if (s <= UPDATE) {
+            SDL_SetRenderDrawColor(renderer, 0x66, 0x66, 0x66, 0xff);
+            SDL_RenderDrawLine(renderer, graphX, y + GRAPH_HEIGHT/2, graphX + HISTORY - 1, y + GRAPH_HEIGHT/2);
+        }
+    }
+
+    int y = PANEL_Y + PADDING + NUM_SERIES * rowHeight;
+    atlas.render(renderer, labels[NUM_SERIES], PANEL_X + PADDING, y);
+    atlas.render(renderer, labels[NUM_SERIES + 1], PANEL_X + PADDING, y + textHeight);
+
+    hudSeconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
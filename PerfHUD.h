@@ -0,0 +1,73 @@
+// -*- c++ -*-
+#ifndef PING_PERF_HUD_H
+#define PING_PERF_HUD_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "GlyphAtlas.h"
+
+// An overlay (toggled with F3, or "hud" in the DevConsole) graphing the
+// last HISTORY frames: how long the state took to render and the
+// present (vsync included) took, how many ticks ran and how long they
+// took, and how many textures were uploaded. Networked games add their
+// round-trip time, jitter and traffic. Frames are recorded on the main
+// thread, ticks and network samples on the simulation thread.
+//
+// The overlay's own time is kept out of the frame's render time (and
+// shown separately). It's one batch of bars per graph, and its text is
+// only laid out again a few times a second.
+class PerfHUD {
+public:
+    static const int HISTORY = 120;
+
+    bool visible;
+
+    PerfHUD();
+
+    void addTick(double seconds);
+    // Called after each present, with how long the state's rendering
+    // and the present took.
+    void addFrame(double renderSeconds, double presentSeconds);
+    void addPing(double seconds);
+    void addTraffic(int received, int sent);
+    // Forgets the network samples, for when a networked game ends.
+    void resetNetwork();
+
+    void render(SDL_Renderer *renderer, GlyphAtlas &atlas);
+
+private:
+    enum Series { RENDER, PRESENT, UPDATE, TICKS, UPLOADS, NUM_SERIES };
+    static const char *SERIES_NAMES[];
+    // The value at the top of each graph.
+    static const double SERIES_SCALES[];
+
+    // Per frame (a ring of HISTORY, with next the oldest).
+    double history[NUM_SERIES][HISTORY];
+    int next;
+    double hudSeconds;
+    unsigned long lastUploads;
+
+    // From the simulation thread, since the last frame.
+    std::atomic<long> ticks, tickNanoseconds;
+
+    // Network samples; rtt and jitter (a smoothed average of the change
+    // between consecutive round trips, as in RFC 3550) are in seconds,
+    // and traffic is counted over the second up to trafficStart.
+    std::mutex networkMutex;
+    bool networked;
+    double rtt, jitter;
+    int receivedPerSecond, sentPerSecond, received, sent;
+    Uint32 trafficStart;
+
+    // Text is laid out again every LABEL_INTERVAL milliseconds.
+    static const Uint32 LABEL_INTERVAL = 250;
+    Uint32 labelTime;
+    GlyphAtlas::Layout labels[NUM_SERIES + 2];
+    std::vector<SDL_Rect> bars;
+
+    void layoutLabels(GlyphAtlas &atlas);
+};
+
+#endif
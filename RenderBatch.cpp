@@ -0,0 +1,94 @@
+#include <math.h>
+#include "RenderBatch.h"
+#include "utility.h"
+
+const SDL_Color RenderBatch::WHITE = { 0xff, 0xff, 0xff, 0xff };
+
+void RenderBatch::add(const SDL_Rect *src, double x, double y, double w, double h, double angle, double centerX, double centerY,
+                      const SDL_Color &color) {
+    Quad quad;
+    quad.whole = src == NULL;
+    if (src != NULL)
+        quad.src = *src;
+    quad.x = x;
+    quad.y = y;
+    quad.w = w;
+    quad.h = h;
+    quad.angle = angle;
+    quad.centerX = centerX;
+    quad.centerY = centerY;
+    quad.color = color;
+    quads.push_back(quad);
+}
+
+// angle is 0 and color WHITE by default (see RenderBatch.h).
+void RenderBatch::add(const SDL_Rect *src, double x, double y, double w, double h, double angle, const SDL_Color &color) {
+    add(src, x, y, w, h, angle, w/2, h/2, color);
+}
+
+bool RenderBatch::empty() const {
+    return quads.empty();
+}
+
+void RenderBatch::clear() {
+    quads.clear();
+}
+
+void RenderBatch::render(SDL_Renderer *renderer, Texture &texture) {
+    if (quads.empty() || texture.texture == NULL) {
+        clear();
+        return;
+    }
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    vertices.resize(4 * quads.size());
+    indices.resize(6 * quads.size());
+    for (unsigned int q = 0; q < quads.size(); q++) {
+        const Quad &quad = quads[q];
+        double u0 = 0, v0 = 0, u1 = 1, v1 = 1;
+        if (!quad.whole) {
+            u0 = (double)quad.src.x / texture.w;
+            v0 = (double)quad.src.y / texture.h;
+            u1 = (double)(quad.src.x + quad.src.w) / texture.w;
+            v1 = (double)(quad.src.y + quad.src.h) / texture.h;
+        }
+
+        // Corners go clockwise from the top left, turned about the
+        // center the way SDL_RenderCopyEx() does (clockwise, as y is
+        // down).
+        double cosA = cos(quad.angle * pi/180), sinA = sin(quad.angle * pi/180);
+        double cornerX[4] = { 0, quad.w, quad.w, 0 }, cornerY[4] = { 0, 0, quad.h, quad.h };
+        double u[4] = { u0, u1, u1, u0 }, v[4] = { v0, v0, v1, v1 };
+        for (int c = 0; c < 4; c++) {
+            double dx = cornerX[c] - quad.centerX, dy = cornerY[c] - quad.centerY;
+            SDL_Vertex &vertex = vertices[4*q + c];
+            vertex.position.x = quad.x + quad.centerX + dx * cosA - dy * sinA;
+            vertex.position.y = quad.y + quad.centerY + dx * sinA + dy * cosA;
+            vertex.color = quad.color;
+            vertex.tex_coord.x = u[c];
+            vertex.tex_coord.y = v[c];
+        }
+
+        static const int QUAD_INDICES[] = { 0, 1, 2, 0, 2, 3 };
+        for (int i = 0; i < 6; i++)
+            indices[6*q + i] = 4*q + QUAD_INDICES[i];
+    }
+
+    Texture::draws++;
+    if (SDL_RenderGeometry(renderer, texture.texture, vertices.data(), vertices.size(), indices.data(), indices.size()) != 0)
+        SDLerror("SDL_RenderGeometry");
+#else
+    for (const Quad &quad : quads) {
+        SDL_Rect dst = { (int)quad.x, (int)quad.y, (int)round(quad.w), (int)round(quad.h) };
+        SDL_Point center = { (int)round(quad.centerX), (int)round(quad.centerY) };
+        SDL_SetTextureColorMod(texture.texture, quad.color.r, quad.color.g, quad.color.b);
+        SDL_SetTextureAlphaMod(texture.texture, quad.color.a);
+        Texture::draws++;
+        SDL_RenderCopyEx(renderer, texture.texture, quad.whole ? NULL : &quad.src, &dst, quad.angle, &center, SDL_FLIP_NONE);
+    }
+    SDL_SetTextureColorMod(texture.texture, 0xff, 0xff, 0xff);
+    SDL_SetTextureAlphaMod(texture.texture, 0xff);
+#endif
+
+    clear();
+}
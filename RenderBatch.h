@@ -0,0 +1,47 @@
+// -*- c++ -*-
+#ifndef PING_RENDER_BATCH_H
+#define PING_RENDER_BATCH_H
+
+#include <vector>
+#include <SDL2/SDL.h>
+#include "Texture.h"
+
+// Collects a frame's quads (all drawn from one texture) and submits
+// them in a single SDL_RenderGeometry() call, in the order they were
+// added. SDL older than 2.0.18 doesn't have it, so there they're drawn
+// one SDL_RenderCopyEx() at a time instead.
+class RenderBatch {
+public:
+    static const SDL_Color WHITE;
+
+    // Adds a w by h quad at (x, y), showing src (or all of the texture,
+    // if it's NULL) tinted by color, and turned by angle degrees
+    // clockwise about (x + centerX, y + centerY), as with
+    // SDL_RenderCopyEx().
+    void add(const SDL_Rect *src, double x, double y, double w, double h, double angle, double centerX, double centerY,
+             const SDL_Color &color);
+    // Turned about its own center.
+    void add(const SDL_Rect *src, double x, double y, double w, double h, double angle=0, const SDL_Color &color=WHITE);
+
+    bool empty() const;
+    void clear();
+
+    // Draws everything added since the last render() or clear(), and
+    // clears it.
+    void render(SDL_Renderer *renderer, Texture &texture);
+
+private:
+    struct Quad {
+        SDL_Rect src;
+        bool whole;
+        double x, y, w, h, angle, centerX, centerY;
+        SDL_Color color;
+    };
+    std::vector<Quad> quads;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+#endif
+};
+
+#endif
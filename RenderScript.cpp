@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include "RenderScript.h"
+#include "GameManager.h"
+#include "AIInput.h"
+#include "utility.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Scene {
+    const char *name;
+    int players, wallsPerPlayer;
+    bool classic;
+    int balls;
+};
+
+// From the classic arena up to 40 walls, with more balls as they grow.
+static const Scene SCENES[] = {
+    { "classic", 2, 2, true, 1 },
+    { "2x2", 2, 2, false, 1 },
+    { "4x1", 4, 1, false, 2 },
+    { "8x2", 8, 2, false, 4 },
+    { "16x1", 16, 1, false, 8 },
+    { "20x2", 20, 2, false, 16 },
+};
+static const int NUM_SCENES = sizeof(SCENES) / sizeof(SCENES[0]);
+static const unsigned int SEED = 1;
+// Golden frames are taken after these many ticks (in order).
+static const int GOLDEN_TICKS[] = { 0, 30, 240 };
+static const int NUM_GOLDEN_TICKS = sizeof(GOLDEN_TICKS) / sizeof(GOLDEN_TICKS[0]);
+// Benchmarks start after this many ticks, once the balls are spread out.
+static const int WARMUP_TICKS = 120;
+
+static Game *makeGame(GameManager &m, const Scene &scene) {
+    std::vector<PaddleInput *> inputs;
+    for (int i = 0; i < scene.players; i++)
+        inputs.push_back(new AIInput(AIInput::HARD));
+    Game *game = new Game(&m, inputs, scene.wallsPerPlayer, scene.classic, true, scene.balls);
+    game->seed(SEED);
+    return game;
+}
+
+// Ticks are a tick apart in virtual time, and frames fall halfway
+// between them, so that render() always interpolates by half a tick.
+static void tick(GameManager &m, Game &game) {
+    m.advance(0.5 / game.getTickRate());
+    game.update();
+}
+
+static void renderFrame(GameManager &m, Game &game) {
+    m.advance(0.5 / game.getTickRate());
+    SDL_SetRenderDrawColor(m.renderer, 0, 0, 0, 0xff);
+    SDL_RenderClear(m.renderer);
+    game.render();
+}
+
+static SDL_Surface *capture(GameManager &m) {
+    SDL_Surface *frame = SDL_CreateRGBSurfaceWithFormat(0, GameManager::WIDTH, GameManager::HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (frame == NULL) {
+        SDLerror("SDL_CreateRGBSurfaceWithFormat");
+        return NULL;
+    }
+    if (SDL_RenderReadPixels(m.renderer, NULL, SDL_PIXELFORMAT_ARGB8888, frame->pixels, frame->pitch) != 0) {
+        SDLerror("SDL_RenderReadPixels");
+        SDL_FreeSurface(frame);
+        return NULL;
+    }
+    return frame;
+}
+
+// Returns the number of pixels that differ, or -1 if the sizes do.
+static long countDifferences(SDL_Surface *a, SDL_Surface *b) {
+    if (a->w != b->w || a->h != b->h)
+        return -1;
+
+    long differences = 0;
+    for (int y = 0; y < a->h; y++) {
+        const Uint32 *rowA = (const Uint32 *)((const Uint8 *)a->pixels + y * a->pitch);
+        const Uint32 *rowB = (const Uint32 *)((const Uint8 *)b->pixels + y * b->pitch);
+        for (int x = 0; x < a->w; x++) {
+            if (rowA[x] != rowB[x])
+                differences++;
+        }
+    }
+    return differences;
+}
+
+// Compares frame with the golden at path (or stores it there), returning
+// whether it matched.
+static bool checkGolden(SDL_Surface *frame, const std::string &path, bool baseline) {
+    if (baseline) {
+        if (SDL_SaveBMP(frame, path.c_str()) != 0)
+            return SDLerror("SDL_SaveBMP");
+        std::cout << path << std::endl;
+        return true;
+    }
+
+    SDL_Surface *loaded = SDL_LoadBMP(path.c_str());
+    SDL_Surface *golden = NULL;
+    if (loaded != NULL) {
+        golden = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(loaded);
+    }
+
+    long differences = golden == NULL ? -1 : countDifferences(frame, golden);
+    if (golden == NULL)
+        std::cout << path << ": no golden (" << SDL_GetError() << ")" << std::endl;
+    else if (differences < 0)
+        std::cout << path << ": the golden is " << golden->w << "x" << golden->h << std::endl;
+    else if (differences > 0)
+        std::cout << path << ": " << differences << " pixels differ" << std::endl;
+    SDL_FreeSurface(golden);
+
+    if (differences == 0)
+        return true;
+
+    std::string actual = path.substr(0, path.size() - 4) + ".actual.bmp";
+    if (SDL_SaveBMP(frame, actual.c_str()) != 0)
+        SDLerror("SDL_SaveBMP");
+    return false;
+}
+
+// Every tick is rendered, as in a game (so that each frame interpolates
+// from the tick before), but only the frames after GOLDEN_TICKS are kept.
+static bool golden(GameManager &m, const std::string &dir, bool baseline) {
+    int failures = 0, frames = 0;
+    for (int s = 0; s < NUM_SCENES; s++) {
+        Game *game = makeGame(m, SCENES[s]);
+        int next = 0;
+        for (int t = 0; next < NUM_GOLDEN_TICKS; t++) {
+            if (t > 0)
+                tick(m, *game);
+            renderFrame(m, *game);
+            if (t != GOLDEN_TICKS[next])
+                continue;
+            next++;
+
+            SDL_Surface *frame = capture(m);
+            std::string path = dir + "/" + SCENES[s].name + "-" + std::to_string(t) + ".bmp";
+            if (frame == NULL || !checkGolden(frame, path, baseline))
+                failures++;
+            SDL_FreeSurface(frame);
+            frames++;
+        }
+        delete game;
+    }
+
+    if (!baseline)
+        std::cout << frames - failures << "/" << frames << " frames match" << std::endl;
+    return failures == 0;
+}
+
+// Each frame is rendered after a tick, as in a game, but only the
+// rendering (flushed, so that none of it is left queued) is timed.
+static void bench(GameManager &m, int frames) {
+    std::cout << "arena\tballs\tms/frame\tdraws/frame" << std::endl;
+    for (int s = 0; s < NUM_SCENES; s++) {
+        Game *game = makeGame(m, SCENES[s]);
+        for (int t = 0; t < WARMUP_TICKS; t++)
+            tick(m, *game);
+
+        double seconds = 0;
+        unsigned long draws = Texture::draws;
+        for (int f = 0; f < frames; f++) {
+            tick(m, *game);
+            Clock::time_point start = Clock::now();
+            renderFrame(m, *game);
+            SDL_RenderFlush(m.renderer);
+            seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        std::cout << SCENES[s].name << "\t" << SCENES[s].balls << "\t" << std::fixed << std::setprecision(3)
+                  << seconds / frames * 1000 << "\t" << std::setprecision(1) << (double)(Texture::draws - draws) / frames
+                  << std::endl;
+        delete game;
+    }
+}
+
+static void usage() {
+    std::cerr << "usage: ./ping --headless bench [frames (defaults to 300)]" << std::endl
+              << "       ./ping --headless golden DIR" << std::endl
+              << "       ./ping --headless golden-baseline DIR" << std::endl;
+}
+
+int runHeadless(int argc, char **argv) {
+    if (argc < 1) {
+        usage();
+        return 1;
+    }
+
+    bool isBench = strcmp(argv[0], "bench") == 0;
+    bool isGolden = strcmp(argv[0], "golden") == 0, isBaseline = strcmp(argv[0], "golden-baseline") == 0;
+    if (!isBench && !((isGolden || isBaseline) && argc > 1)) {
+        usage();
+        return 1;
+    }
+
+    GameManager manager(true);
+    if (!manager.init())
+        return 1;
+
+    bool passed = true;
+    if (isBench)
+        bench(manager, argc > 1 ? std::max(1, atoi(argv[1])) : 300);
+    else
+        passed = golden(manager, argv[1], isBaseline);
+
+    manager.cleanup();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+// -*- c++ -*-
+#ifndef PING_RENDER_SCRIPT_H
+#define PING_RENDER_SCRIPT_H
+
+// Runs a headless GameManager (see GameManager.h) through a fixed set of
+// demo games, for `./ping --headless ...`:
+//
+//   bench [frames]          how long a frame takes to render, and how many
+//                           texture draws it makes, in each arena
+//   golden DIR              renders each arena at a few ticks and compares
+//                           the frames pixel for pixel with DIR's; fails
+//                           (writing the frames that differ next to them)
+//                           if any differ or are missing
+//   golden-baseline DIR     the same, storing the frames in DIR
+//
+// Games are seeded and time is virtual, so the same build renders the
+// same frames every run. Returns the process's exit status.
+int runHeadless(int argc, char **argv);
+
+#endif
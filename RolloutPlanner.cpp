@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <math.h>
+#include <memory>
+#include <mutex>
+#include "RolloutPlanner.h"
+#include "ThreadPool.h"
+#include "utility.h"
+
+typedef std::chrono::steady_clock Clock;
+
+const double RolloutPlanner::HORIZON = .75;
+
+// The ticks plans can switch moves on (besides never).
+static const int SWITCH_TICKS[] = { 1, 2, 4, 8, 16, 32 };
+static const int NUM_SWITCH_TICKS = sizeof(SWITCH_TICKS) / sizeof(SWITCH_TICKS[0]);
+static const int MAX_POOL_THREADS = 4;
+
+// What rollouts are worth: hitting the ball beats anything that
+// doesn't score or concede, and sooner is better (and conceding later
+// less bad). Otherwise, it's how close (in pixels, scaled) the paddle
+// ends up to where the ball's heading.
+static const double HIT_VALUE = 1000;
+static const double SCORE_VALUE = 2000;
+static const double CONCEDE_VALUE = -10000;
+
+// One pool for every planner, started on first use.
+static ThreadPool &getPool() {
+    static ThreadPool pool(std::min<unsigned int>(MAX_POOL_THREADS, std::max(1u, std::thread::hardware_concurrency())));
+    return pool;
+}
+
+// Runs the state forward a step at a time (as a rollout has to catch
+// every hit, and a ball's collision latch doesn't last a tick) with
+// player following plan and the other paddles coasting. Returns false
+// if it's past the deadline before it's done.
+static bool rollout(const SharedState &state, int player, int ballNum, const RolloutPlanner::Plan &plan, int ticks,
+                    Clock::time_point deadline, double &value) {
+    SharedState copy(state);
+    copy.listener = NULL;
+    copy.setTickRate(SharedState::PHYSICS_RATE);
+    int stepsPerTick = std::max(1, SharedState::PHYSICS_RATE / state.getTickRate());
+    std::vector<int> inputs(copy.players.size(), 0);
+
+    // After a hit, the rollout goes on to see whether the return scores.
+    int hitTick = -1;
+    for (int tick = 0; tick < ticks; tick++) {
+        if (Clock::now() > deadline)
+            return false;
+
+        inputs[player] = tick < plan.switchTick ? plan.first : plan.second;
+        for (int step = 0; step < stepsPerTick; step++) {
+            copy.update(inputs);
+
+            for (int collided : copy.collided) {
+                if (collided == player && hitTick == -1)
+                    hitTick = tick;
+            }
+            // Whoever doesn't concede a point scores one.
+            if (copy.scores != state.scores) {
+                value = copy.scores[player] == state.scores[player] ? CONCEDE_VALUE + tick : SCORE_VALUE - tick;
+                return true;
+            }
+        }
+    }
+    if (hitTick != -1) {
+        value = HIT_VALUE - hitTick;
+        return true;
+    }
+
+    Vector2 dir(copy.players.cosTheta[player], copy.players.sinTheta[player]);
+    Vector2 vertices[4], center;
+    copy.players.getVertices(player, vertices);
+    double time;
+    value = 0;
+    if (copy.traceBall(ballNum, player, 40 * copy.scale, center, time))
+        value = -fabs((center - (vertices[1] + vertices[2]) / 2) * dir) / copy.scale;
+    return true;
+}
+
+// What one plan() shares with the pool's threads. It's kept alive by
+// the tasks that plan() submits, as they may only start once plan() has
+// returned: they find it closed then, and leave without touching the
+// state (which only the running ones, that plan() waits for, do).
+struct Search {
+    const SharedState *state;
+    int player, ballNum, ticks;
+    Clock::time_point deadline;
+    std::vector<RolloutPlanner::Plan> plans;
+    std::vector<double> values;
+    std::vector<char> finished;
+    std::atomic<unsigned int> next;
+
+    std::mutex mutex;
+    std::condition_variable done;
+    int running;
+    bool closed;
+    double helperSeconds;
+
+    Search() : next(0), running(0), closed(false), helperSeconds(0) {}
+
+    void work() {
+        for (unsigned int i = next++; i < plans.size(); i = next++) {
+            if (!rollout(*state, player, ballNum, plans[i], ticks, deadline, values[i]))
+                break;
+            finished[i] = true;
+        }
+    }
+};
+
+// budget is DEFAULT_BUDGET and rollouts 0 (so that it's timed) by
+// default (see RolloutPlanner.h).
+RolloutPlanner::RolloutPlanner(int budget, int rollouts) : helperSeconds(0), budget(budget), rollouts(rollouts) {
+    best.first = best.second = 0;
+    best.switchTick = 0;
+}
+
+int RolloutPlanner::plan(const SharedState &state, int player, int ballNum, int fallback) {
+    std::shared_ptr<Search> search = std::make_shared<Search>();
+    search->state = &state;
+    search->player = player;
+    search->ballNum = ballNum;
+    search->ticks = std::max(1, (int)(HORIZON * state.getTickRate()));
+    search->deadline = rollouts > 0 ? Clock::time_point::max() : Clock::now() + std::chrono::microseconds(budget);
+    int ticks = search->ticks;
+
+    // Last tick's best, a tick on, and then holding the fallback, come
+    // first; the rest are in no particular order.
+    std::vector<Plan> &plans = search->plans;
+    Plan carried = best;
+    carried.switchTick = std::max(0, carried.switchTick - 1);
+    plans.push_back(carried);
+    Plan hold = { fallback, fallback, 0 };
+    plans.push_back(hold);
+    for (int first = -1; first <= 1; first++) {
+        for (int second = -1; second <= 1; second++) {
+            if (first == second) {
+                Plan constant = { first, first, 0 };
+                plans.push_back(constant);
+                continue;
+            }
+            for (int s = 0; s < NUM_SWITCH_TICKS && SWITCH_TICKS[s] < ticks; s++) {
+                Plan switching = { first, second, SWITCH_TICKS[s] };
+                plans.push_back(switching);
+            }
+        }
+    }
+
+    if (rollouts > 0 && (unsigned int)rollouts < plans.size())
+        plans.resize(rollouts);
+    search->values.resize(plans.size());
+    search->finished.resize(plans.size(), false);
+
+    // This thread works alongside the pool's, which may be busy with
+    // other planners' rollouts.
+    ThreadPool &pool = getPool();
+    for (unsigned int t = 0; t < pool.size(); t++) {
+        pool.submit([search] {
+            {
+                std::lock_guard<std::mutex> lock(search->mutex);
+                if (search->closed)
+                    return;
+                search->running++;
+            }
+            double start = threadCPUSeconds();
+            search->work();
+            std::lock_guard<std::mutex> lock(search->mutex);
+            search->helperSeconds += threadCPUSeconds() - start;
+            if (--search->running == 0)
+                search->done.notify_one();
+        });
+    }
+    search->work();
+    {
+        std::unique_lock<std::mutex> lock(search->mutex);
+        search->closed = true;
+        search->done.wait(lock, [&] { return search->running == 0; });
+        helperSeconds += search->helperSeconds;
+    }
+
+    const std::vector<double> &values = search->values;
+    const std::vector<char> &finished = search->finished;
+    int chosen = -1;
+    for (unsigned int i = 0; i < plans.size(); i++) {
+        if (finished[i] && (chosen == -1 || values[i] > values[chosen]))
+            chosen = i;
+    }
+    if (chosen == -1) {
+        best = hold;
+        return fallback;
+    }
+
+    best = plans[chosen];
+    return best.switchTick > 0 ? best.first : best.second;
+}
@@ -0,0 +1,50 @@
+// -*- c++ -*-
+#ifndef PING_ROLLOUT_PLANNER_H
+#define PING_ROLLOUT_PLANNER_H
+
+#include "SharedState.h"
+
+// Model-predictive control for AIInput's INSANE difficulty. Each
+// candidate plan (one move held for a while, then another) is tried by
+// copying the state and running the real physics forward with it,
+// paddle collisions, spin and all, and the plan that does best is
+// followed for a tick before planning again. Rollouts are shared out
+// over a small thread pool, and the search is anytime: it stops at the
+// budget, with the best plan so far, and plans are tried most
+// promising first (last tick's best, then the fallback move). Every
+// planner shares the pool, but plan() doesn't wait for rollouts that
+// haven't started by the budget; only for the ones already running,
+// which stop at it.
+class RolloutPlanner {
+public:
+    // How far ahead plans go, in seconds.
+    static const double HORIZON;
+    static const int DEFAULT_BUDGET = 1000;
+
+    // Each plan() may take budget microseconds, unless rollouts is set:
+    // then it tries that many plans (or every plan, if there are fewer)
+    // all the way through, however long they take, so that its moves
+    // only depend on the state.
+    RolloutPlanner(int budget=DEFAULT_BUDGET, int rollouts=0);
+
+    // The CPU time (in seconds) the pool's threads have spent on this
+    // planner's rollouts, so that it can be counted with the calling
+    // thread's (as ping-sim does).
+    double helperSeconds;
+
+    // Returns player's move, planned to play ballNum; fallback is the
+    // move to make if no rollout finishes within the budget.
+    int plan(const SharedState &state, int player, int ballNum, int fallback);
+
+    struct Plan {
+        int first, second;
+        // The tick the move changes from first to second on.
+        int switchTick;
+    };
+
+private:
+    int budget, rollouts;
+    Plan best;
+};
+
+#endif
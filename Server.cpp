@@ -1,25 +1,33 @@
 #include <SDL2/SDL_net.h>
 #include <iostream>
 #include <sstream>
-#include <time.h>
 #include <stdlib.h>
+#include <string.h>
 #include "Server.h"
 #include "utility.h"
 
-// classic is false by default (see Server.h).
-Server::Server(int numPlayers, int wallsPerPlayer, bool classic)
-    : clients(numPlayers, NULL), classic(classic), bounce(false), hit(false), state(this) {
+// classic is false, numBalls is 1, tickRate is
+// SharedState::DEFAULT_TICK_RATE and botDifficulty is MEDIUM by default
+// (see Server.h).
+Server::Server(int numPlayers, int wallsPerPlayer, bool classic, int numBalls, int tickRate, int botDifficulty)
+    : clients(numPlayers, NULL), classic(classic), bounce(false), hit(false), botDifficulty(botDifficulty), state(this) {
     if (classic)
-        state.resetClassic();
+        state.resetClassic(numBalls);
     else
-        state.reset(numPlayers, wallsPerPlayer);
+        state.reset(numPlayers, wallsPerPlayer, numBalls);
+    state.setTickRate(tickRate);
 
-    state.ball.v = 0;
+    if (botDifficulty != -1) {
+        for (unsigned int i = 0; i < state.players.size(); i++)
+            bots.add(i, (AIInput::Difficulty)botDifficulty);
+    }
+
+    // The balls wait for the first client (or, without bots, for every
+    // seat to be filled).
+    state.stopBalls();
 }
 
 bool Server::init() {
-    srand(time(NULL));
-
     if (SDLNet_Init() != 0)
         return SDLerror("SDLNet_Init()");
 
@@ -39,6 +47,13 @@ bool Server::init() {
     return true;
 }
 
+int Server::countClients() const {
+    int count = 0;
+    for (const auto &client : clients)
+        count += client != NULL;
+    return count;
+}
+
 void Server::onBounce() { 
     bounce = true;
 }
@@ -61,7 +76,7 @@ void Server::handleActivity() {
             clients[n] = SDLNet_TCP_Accept(server);
             SDLNet_TCP_AddSocket(socketSet, clients[n]);
 
-            int bufSize = 4 + 16 * state.players.size();
+            int bufSize = 8 + 16 * state.players.size();
             if (state.players.size() == 2 && state.boundaries.size() == 4)
                 bufSize++;
 
@@ -71,25 +86,31 @@ void Server::handleActivity() {
             buf[pos++] = (char)n;
             buf[pos++] = (char)state.players.size();
             buf[pos++] = (char)state.boundaries.size() / state.players.size();
+            SDLNet_Write16(state.balls.size(), &buf[pos]);
+            pos += 2;
+            // Clients update at the server's rate.
+            SDLNet_Write16(state.getTickRate(), &buf[pos]);
+            pos += 2;
             if (state.players.size() == 2 && state.boundaries.size() == 4)
                 buf[pos++] = classic;
 
-            for (const auto &player : state.players) {
-                *((double *)&buf[pos]) = htond(player.x);
+            for (unsigned int i = 0; i < state.players.size(); i++) {
+                double x = htond(state.players.x[i]), y = htond(state.players.y[i]);
+                memcpy(&buf[pos], &x, 8);
                 pos += 8;
-                *((double *)&buf[pos]) = htond(player.y);
+                memcpy(&buf[pos], &y, 8);
                 pos += 8;
             }
             SDLNet_TCP_Send(clients[n], buf, bufSize);
 
-            bool full = true;
-            for (auto c = clients.begin(); full && c < clients.end(); ++c) {
-                if (*c == NULL)
-                    full = false;
+            // The client takes over the seat from its bot, if it has one.
+            if (botDifficulty != -1) {
+                bots.remove(n);
+                if (countClients() == 1)
+                    state.resetBalls();
+            } else if (countClients() == (int)clients.size()) {
+                state.resetBalls();
             }
-
-            if (full)
-                state.resetBall();
         } else {
             TCPsocket tmp = SDLNet_TCP_Accept(server);
             const char buf[] = { Server::FULL };
@@ -116,36 +137,57 @@ void Server::handleActivity() {
                 SDLNet_TCP_DelSocket(socketSet, clients[i]);
                 SDLNet_TCP_Close(clients[i]);
                 clients[i] = NULL;
-                state.ball.v = 0;
+
+                // A bot takes the seat back, and the game carries on
+                // as long as anyone's still playing.
+                if (botDifficulty != -1)
+                    bots.add(i, (AIInput::Difficulty)botDifficulty);
+                if (botDifficulty == -1 || countClients() == 0)
+                    state.stopBalls();
             } else if (buffer[0] == Client::MOVE) {
                 inputs[i] += buffer[1];
+            } else if (buffer[0] == Client::PING) {
+                char buf[2] = { Server::PONG, buffer[1] };
+                SDLNet_TCP_Send(clients[i], buf, 2);
             }
         }
     }
 
+    if (bots.size() > 0 && countClients() > 0)
+        bots.update(state, inputs);
+
     SharedState old(state);
     state.update(inputs);
 
-    std::vector<Entity *> oldEntities = old.getEntities();
-    std::vector<Entity *> currentEntities = state.getEntities();
-
-    std::vector<EntityUpdate> updates[oldEntities.size()];
-
-    for (unsigned int i = 0; i < oldEntities.size(); i++) {
-        if (oldEntities[i]->x != currentEntities[i]->x)
-            updates[i].push_back({ EntityField::X, *((Uint64 *)&currentEntities[i]->x) });
-        if (oldEntities[i]->y != currentEntities[i]->y)
-            updates[i].push_back({ EntityField::Y, *((Uint64 *)&currentEntities[i]->y) });
+    unsigned int numEntities = state.getNumEntities();
+    std::vector<EntityUpdate> updates[numEntities];
+
+    for (unsigned int i = 0; i < numEntities; i++) {
+        Entity oldEntity = old.getEntity(i), currentEntity = state.getEntity(i);
+        if (oldEntity.x != currentEntity.x)
+            updates[i].push_back({ EntityField::X, doubleToBits(currentEntity.x) });
+        if (oldEntity.y != currentEntity.y)
+            updates[i].push_back({ EntityField::Y, doubleToBits(currentEntity.y) });
+        // Balls' speeds are sent (when they're hit or served) so that
+        // clients can tell how far they could have gone in a tick.
+        if (i < state.balls.size()) {
+            double speed = currentEntity.getV();
+            if (oldEntity.getV() != speed)
+                updates[i].push_back({ EntityField::SPEED, doubleToBits(speed) });
+        }
         // Would be nice to find a way to make this neater...
-        if (i > 0 && old.scores[i-1] != state.scores[i-1])
-            updates[i].push_back({ EntityField::SCORE, (Uint64)state.scores[i-1]});
+        int player = i - state.balls.size();
+        if (player >= 0 && old.scores[player] != state.scores[player])
+            updates[i].push_back({ EntityField::SCORE, (Uint64)state.scores[player]});
     }
 
-    int bufSize = 3;
+    // Entity indices and counts are 16-bit, since there can be
+    // hundreds of balls.
+    int bufSize = 4;
     int changedEntities = 0;
-    for (unsigned int i = 0; i < oldEntities.size(); i++) {
+    for (unsigned int i = 0; i < numEntities; i++) {
         if (!updates[i].empty()) {
-            bufSize += 2;
+            bufSize += 3;
             changedEntities++;
         }
         bufSize += updates[i].size() * 9;
@@ -155,16 +197,19 @@ void Server::handleActivity() {
     int pos = 0;
     buf[pos++] = Server::STATE;
     buf[pos++] = ((int)hit << 1) | (int)bounce; 
-    buf[pos++] = changedEntities;
+    SDLNet_Write16(changedEntities, &buf[pos]);
+    pos += 2;
 
-    for (unsigned int i = 0; i < oldEntities.size(); i++) {
+    for (unsigned int i = 0; i < numEntities; i++) {
         if (updates[i].empty())
             continue;
-        buf[pos++] = i;
+        SDLNet_Write16(i, &buf[pos]);
+        pos += 2;
         buf[pos++] = updates[i].size();
         for (const auto &update : updates[i]) {
             buf[pos++] = update.field;
-            *((Uint64 *)&buf[pos]) = hton64(update.val);
+            Uint64 val = hton64(update.val);
+            memcpy(&buf[pos], &val, 8);
             pos += 8;
         }
     }
@@ -186,7 +231,7 @@ int Server::run() {
 
     Uint32 time, last = SDL_GetTicks();
     double lag = 0;
-    const double MS_PER_UPDATE = 1000.0 / 60.0;
+    const double MS_PER_UPDATE = 1000.0 / state.getTickRate();
     while (true) {
         if (lag < MS_PER_UPDATE) {
             SDL_Delay(round(MS_PER_UPDATE - lag));
@@ -205,27 +250,58 @@ int Server::run() {
 
 int main(int argc, char **argv) {
     if (argc < 2) {
-        std::cerr << "usage: ./server [number of players] [walls per player (defaults to 1)] [--classic (-c)]" << std::endl;
+        std::cerr << "usage: ./server [number of players] [walls per player (defaults to 1)] [--classic (-c)] [--balls (-b) number of balls]" << std::endl
+                  << "                [--rate (-r) ticks per second (defaults to " << SharedState::DEFAULT_TICK_RATE
+                  << ", at most " << SharedState::PHYSICS_RATE << ")]" << std::endl
+                  << "                [--bots (-a) none|easy|medium|hard|insane (plays empty seats; defaults to medium)]" << std::endl;
         return 1;
     }
 
     bool classic = false;
+    int numBalls = 1, tickRate = SharedState::DEFAULT_TICK_RATE, botDifficulty = AIInput::MEDIUM;
+    std::vector<int> args;
     for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--classic") == 0) {
+        if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--classic") == 0)
             classic = true;
-            break;
-        }
+        else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--balls") == 0) && i + 1 < argc)
+            numBalls = std::stoi(argv[++i]);
+        else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--rate") == 0) && i + 1 < argc)
+            tickRate = std::stoi(argv[++i]);
+        else if ((strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--bots") == 0) && i + 1 < argc) {
+            const char *name = argv[++i];
+            botDifficulty = -2;
+            for (int d = 0; d < AIInput::NUM_DIFFICULTY; d++) {
+                if (strcasecmp(name, AIInput::DIFFICULTY_STRS[d]) == 0)
+                    botDifficulty = d;
+            }
+            if (strcmp(name, "none") == 0)
+                botDifficulty = -1;
+            if (botDifficulty == -2) {
+                std::cerr << "Unknown bot difficulty " << name << "." << std::endl;
+                return 1;
+            }
+        } else
+            args.push_back(std::stoi(argv[i]));
     }
 
     int numPlayers, wallsPerPlayer = 1;
     if (classic)
         numPlayers = wallsPerPlayer = 2;
     else {
-        numPlayers = std::stoi(argv[1]);
-        if (argc > 2)
-            wallsPerPlayer = std::stoi(argv[2]);
+        if (args.empty()) {
+            std::cerr << "Missing number of players." << std::endl;
+            return 1;
+        }
+        numPlayers = args[0];
+        if (args.size() > 1)
+            wallsPerPlayer = args[1];
+    }
+
+    if (tickRate < 1 || tickRate > SharedState::PHYSICS_RATE) {
+        std::cerr << "The tick rate must be between 1 and " << SharedState::PHYSICS_RATE << "." << std::endl;
+        return 1;
     }
 
-    Server server(numPlayers, wallsPerPlayer, classic);
+    Server server(numPlayers, wallsPerPlayer, classic, numBalls, tickRate, botDifficulty);
     return server.run();
 }
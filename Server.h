@@ -5,13 +5,15 @@
 #include <vector>
 #include "StateListener.h"
 #include "SharedState.h"
+#include "AIBatch.h"
 
 namespace Client {
-    enum ClientCode { MOVE = 1 };
+    // PING's byte is echoed back in a PONG, to time the round trip.
+    enum ClientCode { MOVE = 1, PING };
 }
 
 namespace EntityField {
-    enum Field { X, Y, SCORE };
+    enum Field { X, Y, SCORE, SPEED };
 }
 
 struct EntityUpdate {
@@ -21,9 +23,12 @@ struct EntityUpdate {
 
 class Server: public StateListener {
 public:
-    enum ServerCode { INIT = 1, STATE, DISCONNECT, FULL };
+    enum ServerCode { INIT = 1, STATE, DISCONNECT, FULL, PONG };
 
-    Server(int numPlayers, int wallsPerPlayer, bool classic=false);
+    // Seats without a client are played by AIs at botDifficulty (or, if
+    // it's -1, left empty until every seat is filled).
+    Server(int numPlayers, int wallsPerPlayer, bool classic=false, int numBalls=1, int tickRate=SharedState::DEFAULT_TICK_RATE,
+           int botDifficulty=AIInput::MEDIUM);
     void onBounce();
     void onHit();
     int run();
@@ -34,10 +39,13 @@ private:
     TCPsocket server;
     std::vector<TCPsocket> clients;
     bool classic, bounce, hit;
+    int botDifficulty;
 
     SharedState state;
+    AIBatch bots;
 
     bool init();
+    int countClients() const;
     void handleActivity();
     void update();
 };
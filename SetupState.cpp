@@ -39,15 +39,15 @@ void SetupState::updateWPPTexture() {
 
 void SetupState::updateTextures(Player &player) {
     if (player.type == HUMAN) {
-        const char *upText = "_", *downText = "_";
+        std::string upText = "_", downText = "_";
 
         if (!waitingForKey || selection.button != UP_KEY)
             upText = getShortKeyName(SDL_GetKeyFromScancode(((KeyboardInput *)player.input)->upKey), 7, 6);
-        player.texture1 = Texture::fromText(m->renderer, m->fonts[FONT_RND][SIZE_12], upText);
+        player.texture1 = Texture::fromText(m->renderer, m->fonts[FONT_RND][SIZE_12], upText.c_str());
 
         if (!waitingForKey || selection.button != DOWN_KEY)
             downText = getShortKeyName(SDL_GetKeyFromScancode(((KeyboardInput *)player.input)->downKey), 7, 6);
-        player.texture2 = Texture::fromText(m->renderer, m->fonts[FONT_RND][SIZE_12], downText);
+        player.texture2 = Texture::fromText(m->renderer, m->fonts[FONT_RND][SIZE_12], downText.c_str());
     } else {
         player.texture1 = Texture::fromText(m->renderer, m->fonts[FONT_RND][SIZE_12],
                                             AIInput::DIFFICULTY_STRS[((AIInput *)player.input)->difficulty]);
@@ -1,45 +1,116 @@
 #include <algorithm>
 #include <assert.h>
 #include <math.h>
+#include <sstream>
 #include "SharedState.h"
 #include "GameManager.h"
 #include "utility.h"
 
+// The length of a physics step, in seconds.
+static const double STEP = 1.0 / SharedState::PHYSICS_RATE;
+
+// These were all tuned for one step every 60th of a second: a serve at
+// 3 pixels per tick, paddles accelerating by 1 pixel per tick per tick
+// (scaled with the arena), slowing by .1 and topping out at 10.
+static const double BALL_SPEED = 180;
+static const double PADDLE_ACCELERATION = 3600;
+static const double PADDLE_FRICTION = 360;
+static const double MAX_PADDLE_SPEED = 600;
+// Spin wraps around at a quarter turn per 60th of a second.
+static const double MAX_SPIN = 30 * pi;
+// A ball hit again within this many steps (a 60th of a second) of its
+// last hit is only bounced back; otherwise one pinched between two
+// paddles, or a paddle and a wall, gets faster and faster without
+// bound.
+static const int REHIT_STEPS = SharedState::PHYSICS_RATE / 60;
+
 // listener is NULL by default (see SharedState.h).
-SharedState::SharedState(StateListener *listener) : listener(listener) {
+SharedState::SharedState(StateListener *listener)
+    : listener(listener), broadphase(true), tickRate(DEFAULT_TICK_RATE), stepCredit(0), trajectoryCount(0), rng(std::random_device()()) {
 }
 
-SharedState::SharedState(int numPlayers, int wallsPerPlayer, StateListener *listener) : listener(listener) {
+SharedState::SharedState(int numPlayers, int wallsPerPlayer, StateListener *listener)
+    : listener(listener), broadphase(true), tickRate(DEFAULT_TICK_RATE), stepCredit(0), trajectoryCount(0), rng(std::random_device()()) {
     reset(numPlayers, wallsPerPlayer);
 }
 
-std::vector<Entity *> SharedState::getEntities() {
-    std::vector<Entity *> entities(players.size() + 1);
-    entities[0] = &ball;
-    for (unsigned int i = 0; i < players.size(); i++)
-        entities[i+1] = &players[i];
+void SharedState::seed(unsigned int seed) {
+    rng.seed(seed);
+}
+
+int SharedState::getTickRate() const {
+    return tickRate;
+}
+
+void SharedState::setTickRate(int rate) {
+    assert(rate >= 1 && rate <= PHYSICS_RATE);
+    tickRate = rate;
+    stepCredit = 0;
+}
+
+unsigned int SharedState::getNumEntities() const {
+    return balls.size() + players.size();
+}
+
+Entity SharedState::getEntity(unsigned int n) const {
+    if (n < balls.size())
+        return balls[n];
+    return players[n - balls.size()];
+}
+
+void SharedState::setEntity(unsigned int n, const Entity &entity) {
+    if (n < balls.size()) {
+        balls.set(n, entity);
+        changeTrajectory(n);
+    } else
+        players.set(n - balls.size(), entity);
+}
 
-    return entities;
+double SharedState::getMaxSpeed(unsigned int n) const {
+    if (n < balls.size())
+        return fabs(balls.v[n]);
+    return MAX_PADDLE_SPEED;
 }
 
-void SharedState::resetBall() {
-    ball.w = ball.h = 20 * scale;
-    ball.x = GameManager::WIDTH/2 - ball.w/2;
-    ball.y = centerY;
-    ball.orientation = ballRotation = 0;
-    int boundaryIndex = playerToBoundaryIndex(rand() % players.size()) - 1;
+void SharedState::resetBall(unsigned int n) {
+    balls.w[n] = balls.h[n] = 20 * scale;
+    balls.x[n] = GameManager::WIDTH/2 - balls.w[n]/2;
+    balls.y[n] = centerY;
+    balls.setOrientation(n, 0);
+    ballRotations[n] = 0;
+    ballSpins[n] = Vector2(1, 0);
+    int boundaryIndex = playerToBoundaryIndex(std::uniform_int_distribution<int>(0, players.size() - 1)(rng)) - 1;
     Vector2 &boundary = boundaries[(boundaries.size() + boundaryIndex) % boundaries.size()];
-    double startAngle = atan2(boundary.y - ball.y, boundary.x - ball.x);
-    ball.theta = startAngle + rand() / (double)RAND_MAX * 2*pi / boundaries.size();
-    ball.v = 3 * scale;
+    double startAngle = atan2(boundary.y - balls.y[n], boundary.x - balls.x[n]);
+    balls.setTheta(n, startAngle + std::uniform_real_distribution<double>(0, 2*pi / boundaries.size())(rng));
+    balls.v[n] = BALL_SPEED * scale;
+    changeTrajectory(n);
+}
+
+void SharedState::resetBalls() {
+    for (unsigned int i = 0; i < balls.size(); i++)
+        resetBall(i);
+}
+
+void SharedState::stopBalls() {
+    for (unsigned int i = 0; i < balls.size(); i++) {
+        balls.v[i] = 0;
+        changeTrajectory(i);
+    }
 }
 
-void SharedState::resetClassic() {
+// numBalls is 1 by default (see SharedState.h).
+void SharedState::resetClassic(int numBalls) {
     players.resize(2);
     scores.resize(2);
     boundaries.resize(4);
+    balls.resize(numBalls);
+    ballRotations.resize(numBalls);
+    ballSpins.resize(numBalls);
+    collided.assign(numBalls, -1);
+    hitSteps.assign(numBalls, REHIT_STEPS);
+    ballTrajectories.resize(numBalls);
 
-    collided = -1;
     centerY = GameManager::HEIGHT / 2;
     scale = 1.0;
     playerBoundaryOffset = 1;
@@ -48,25 +119,32 @@ void SharedState::resetClassic() {
     boundaries[1] = Vector2(-1, -1);
     boundaries[2] = Vector2(GameManager::WIDTH, -1);
     boundaries[3] = Vector2(GameManager::WIDTH, GameManager::HEIGHT);
+    geometry = std::make_shared<ArenaGeometry>(boundaries, players.size(), playerBoundaryOffset);
 
     for (int i = 0; i < 2; i++) {
-        players[i].w = 20;
-        players[i].h = 80;
-        players[i].setCenter(30 + i * (GameManager::WIDTH - 60), GameManager::HEIGHT / 2);
-        players[i].theta = pi/2;
-        players[i].orientation = i * pi;
+        players.w[i] = 20;
+        players.h[i] = 80;
+        players.setCenter(i, 30 + i * (GameManager::WIDTH - 60), GameManager::HEIGHT / 2);
+        players.setTheta(i, pi/2);
+        players.setOrientation(i, i * pi);
     }
 
     for (int &score : scores)
         score = 0;
 
-    resetBall();
+    resetBalls();
 }
 
-void SharedState::reset(int numPlayers, int wallMult) {
+// numBalls is 1 by default (see SharedState.h).
+void SharedState::reset(int numPlayers, int wallMult, int numBalls) {
     players.resize(numPlayers);
     scores.resize(numPlayers);
-    collided = -1;
+    balls.resize(numBalls);
+    ballRotations.resize(numBalls);
+    ballSpins.resize(numBalls);
+    collided.assign(numBalls, -1);
+    hitSteps.assign(numBalls, REHIT_STEPS);
+    ballTrajectories.resize(numBalls);
 
     int numWalls = players.size() * wallMult;
 
@@ -105,21 +183,27 @@ void SharedState::reset(int numPlayers, int wallMult) {
         v.y -= sideLength * sin(theta);
     }
 
+    geometry = std::make_shared<ArenaGeometry>(boundaries, players.size(), playerBoundaryOffset);
+
     for (unsigned int i = 0; i < players.size(); i++) {
-        players[i].w = std::max(1.0, 20 * scale);
-        players[i].h = std::max(1.0, 80 * scale);
+        players.w[i] = std::max(1.0, 20 * scale);
+        players.h[i] = std::max(1.0, 80 * scale);
 
         int boundaryIndex = playerToBoundaryIndex(i);
         double angle = pi/2 - boundaryIndex * exteriorAngle;
 
         Vector2 midpoint = (boundaries[boundaryIndex] + boundaries[(boundaries.size()+boundaryIndex-1) % boundaries.size()]) / 2;
-        players[i].setCenter(midpoint.x + 30 * scale * cos(angle), midpoint.y - 30 * scale * sin(angle));
-        players[i].theta = fmod(boundaryIndex * exteriorAngle, 2*pi);
-        if (players[i].theta >= pi)
-            players[i].theta -= pi;
-
-        players[i].v = 0;
-        players[i].orientation = fmod(3*pi/2 + boundaryIndex * exteriorAngle, 2*pi);
+        // In huge arenas the paddles hit their minimum size, and would
+        // otherwise stick out past their own boundaries.
+        double inset = std::max(30 * scale, players.w[i] / 2.0 + 1);
+        players.setCenter(i, midpoint.x + inset * cos(angle), midpoint.y - inset * sin(angle));
+        double theta = fmod(boundaryIndex * exteriorAngle, 2*pi);
+        if (theta >= pi)
+            theta -= pi;
+        players.setTheta(i, theta);
+
+        players.v[i] = 0;
+        players.setOrientation(i, fmod(3*pi/2 + boundaryIndex * exteriorAngle, 2*pi));
 
         scores[i] = 0;
     }
@@ -127,40 +211,56 @@ void SharedState::reset(int numPlayers, int wallMult) {
     for (int &score : scores)
         score = 0;
 
-    resetBall();
+    resetBalls();
 }
 
 void SharedState::update(std::vector<int> inputs) {
+    // Each tick's inputs are held for all of its steps.
+    for (stepCredit += PHYSICS_RATE; stepCredit >= tickRate; stepCredit -= tickRate)
+        step(inputs);
+}
+
+void SharedState::step(const std::vector<int> &inputs) {
     // TODO: Break up into multiple methods?
+    // Paddle velocities and positions are updated in whole passes over
+    // the entity store, before any collision handling.
     for (unsigned int i = 0; i < players.size(); i++) {
-        int min = -10, max = 10;
-        int change = inputs[i];
-        if (abs(change + players[i].v) < abs(players[i].v)) {
+        double &v = players.v[i];
+        double min = -MAX_PADDLE_SPEED, max = MAX_PADDLE_SPEED;
+        double change = inputs[i] * scale * PADDLE_ACCELERATION * STEP;
+        if (fabs(change + v) < fabs(v)) {
             change *= 2;
-            if (players[i].v > 0)
+            if (v > 0)
                 min = 0;
             else
                 max = 0;
         }
 
-        players[i].v = clamp(players[i].v + change * scale, min, max);
-        players[i].update();
+        v = clamp(v + change, min, max);
+    }
+
+    players.update(STEP);
+
+    const ArenaGeometry &arena = *geometry;
 
+    for (unsigned int i = 0; i < players.size(); i++) {
         // This is necessary to prevent the boundary check's halting
         // from interfering with paddle/paddle collision resolution.
         bool haltPlayer = false;
 
         // Check paddle for collisions with neighboring boundaries.
         for (int b = -1; b < 3; b += 2) {
-            Vector2 start = boundaries[(boundaries.size()+playerToBoundaryIndex(i)+b-1) % boundaries.size()];
-            Vector2 end = boundaries[(boundaries.size()+playerToBoundaryIndex(i)+b) % boundaries.size()];
-            std::vector<Vector2> vertices = players[i].getVertices();
+            int edge = (boundaries.size()+arena.playerEdges[i]+b) % boundaries.size();
+            Vector2 start = arena.starts[edge];
+            Vector2 end = start + arena.edges[edge];
+            Vector2 vertices[4];
+            players.getVertices(i, vertices);
 
-            for (unsigned int v = 0; v < vertices.size(); v++) {
+            for (unsigned int v = 0; v < 4; v++) {
                 // The following bit of magic detects which side of the
                 // boundary the vertex is on.
                 // (https://stackoverflow.com/questions/1560492/how-to-tell-whether-a-point-is-to-the-right-or-left-side-of-a-line)
-                if (((end.x-start.x)*(vertices[v].y-start.y) - (end.y-start.y)*(vertices[v].x-start.x)) < 0) {
+                if ((arena.edges[edge].x*(vertices[v].y-start.y) - arena.edges[edge].y*(vertices[v].x-start.x)) < 0) {
                     haltPlayer = true;
                     int other;
                     if (v == 0 || v == 3)
@@ -179,8 +279,8 @@ void SharedState::update(std::vector<int> inputs) {
                     Vector2 dir = s.unit();
                     double diff = vertices[v] * dir - intersection * dir + .01;
 
-                    players[i].x -= (dir * diff).x;
-                    players[i].y -= (dir * diff).y;
+                    players.x[i] -= (dir * diff).x;
+                    players.y[i] -= (dir * diff).y;
                 }
             }
         }
@@ -188,11 +288,16 @@ void SharedState::update(std::vector<int> inputs) {
         // Check paddle for collision with neighboring paddles.
         // This only runs for every other paddle.
         for (int j = -1; (i % 2 == 0) && (j + (int)i < (int)players.size()) && (j < 2); j += 2) {
-            Entity &other = players[(players.size()+j+(int)i)%players.size()];
+            unsigned int o = (players.size()+j+(int)i)%players.size();
+            // Bounding boxes are a cheap way to rule out most pairs.
+            if (!players.getBounds(i, 1).overlaps(players.getBounds(o, 1)))
+                continue;
+
+            Entity player(players[i]), other(players[o]);
             std::vector<Vector2> projections;
 
-            if (players[i].collide(other, &projections)) {
-                Vector2 axis1 = (players[i].getVertices()[0] - players[i].getVertices()[3]).unit();
+            if (player.collide(other, &projections)) {
+                Vector2 axis1 = (player.getVertices()[0] - player.getVertices()[3]).unit();
                 Vector2 axis2 = (other.getVertices()[0] - other.getVertices()[3]).unit();
 
                 Vector2 projected;
@@ -204,8 +309,10 @@ void SharedState::update(std::vector<int> inputs) {
 
                 Vector2 proj1(0, 0), proj2(0, 0);
 
-                bool perpendicular1 = fabs(projected * axis1) < 0.0000000001;
-                bool perpendicular2 = fabs(projected * axis2) < 0.0000000001;
+                // The axes are compared by direction alone, since
+                // paddles that only just touch have tiny projections.
+                bool perpendicular1 = fabs(projected.unit() * axis1) < 0.0000000001;
+                bool perpendicular2 = fabs(projected.unit() * axis2) < 0.0000000001;
 
                 if (!perpendicular1)
                     proj1 = projected.length() / fabs(projected.unit() * axis1) * axis1;
@@ -215,10 +322,10 @@ void SharedState::update(std::vector<int> inputs) {
 
                 assert(!(isnan(proj1.x) || isnan(proj1.y) || isnan(proj2.x) || isnan(proj2.y)));
 
-                Vector2 movement1(cos(players[i].theta), sin(players[i].theta)), movement2(cos(other.theta), sin(other.theta));
+                Vector2 movement1(players.cosTheta[i], players.sinTheta[i]), movement2(players.cosTheta[o], players.sinTheta[o]);
 
-                double playerV = std::max(0.0, fabs(axis1 * projected.unit()) * movement1 * axis1 * players[i].v * (j > 0 ? 1 : -1));
-                double otherV = std::max(0.0, fabs(axis2 * projected.unit()) * movement2 * axis2 * other.v * (j > 0 ? -1 : 1));
+                double playerV = std::max(0.0, fabs(axis1 * projected.unit()) * movement1 * axis1 * players.v[i] * (j > 0 ? 1 : -1));
+                double otherV = std::max(0.0, fabs(axis2 * projected.unit()) * movement2 * axis2 * players.v[o] * (j > 0 ? -1 : 1));
                 double totalV = playerV + otherV;
 
                 // This prevents NaN from popping up below; it should
@@ -245,16 +352,21 @@ void SharedState::update(std::vector<int> inputs) {
                 proj1 *= playerV / totalV * 1.01;
                 proj2 *= otherV / totalV * 1.01;
 
+                // Paddles that only just touch would otherwise be
+                // moved by less than rounding can represent.
+                proj1 += 0.0001 * proj1.unit();
+                proj2 += 0.0001 * proj2.unit();
+
                 assert(!(isnan(proj1.x) || isnan(proj1.y) || isnan(proj2.x) || isnan(proj2.y)));
 
                 // Might be good to replace Entity.x/y with a position
                 // vector; it'd make this two whole lines shorter!
-                players[i].x += proj1.x;
-                players[i].y += proj1.y;
+                player.x += proj1.x;
+                player.y += proj1.y;
                 other.x += proj2.x;
                 other.y += proj2.y;
 
-                if (players[i].collide(other, &projections)) {
+                if (player.collide(other, &projections)) {
                     // This handles the case in which the shortest
                     // projection was perpendicular to one of the
                     // paddles' movement axes, and yet that paddle was
@@ -263,31 +375,48 @@ void SharedState::update(std::vector<int> inputs) {
                     // too much in a single step, instead resulting in
                     // the other paddle "hitting" the first one's
                     // broad side).
-
-                    if (perpendicular1)
-                        projected = projections[3];
-                    else if (perpendicular2)
-                        projected = projections[1];
-                    else
+                    // If neither paddle is moving towards the other
+                    // along that axis (which happens when a paddle
+                    // slides past the corner of one that's moving
+                    // away), the first paddle's axis is tried instead,
+                    // and failing that (when they were pushed together
+                    // by something else) they each move half the way.
+
+                    Vector2 alternatives[2];
+                    if (perpendicular1) {
+                        alternatives[0] = projections[3];
+                        alternatives[1] = projections[1];
+                    } else if (perpendicular2) {
+                        alternatives[0] = projections[1];
+                        alternatives[1] = projections[3];
+                    } else
                         assert(false);
 
-                    proj1 = Vector2(0, 0);
-                    proj2 = Vector2(0, 0);
-                    
-                    perpendicular1 = fabs(projected * axis1) < 0.0000000001;
-                    perpendicular2 = fabs(projected * axis2) < 0.0000000001;
-                    
-                    if (!perpendicular1)
-                        proj1 = projected.length() / fabs(projected.unit() * axis1) * axis1;
-                    
-                    if (!perpendicular2)
-                        proj2 = projected.length() / fabs(projected.unit() * axis2) * axis2;
-                    
-                    playerV = std::max(0.0, fabs(axis1 * projected.unit()) * movement1 * axis1 * players[i].v * (j > 0 ? 1 : -1));
-                    otherV = std::max(0.0, fabs(axis2 * projected.unit()) * movement2 * axis2 * other.v * (j > 0 ? -1 : 1));
-                    totalV = playerV + otherV;
+                    for (int a = 0; a < 2; a++) {
+                        projected = alternatives[a];
+                        proj1 = Vector2(0, 0);
+                        proj2 = Vector2(0, 0);
+
+                        perpendicular1 = fabs(projected.unit() * axis1) < 0.0000000001;
+                        perpendicular2 = fabs(projected.unit() * axis2) < 0.0000000001;
+
+                        if (!perpendicular1)
+                            proj1 = projected.length() / fabs(projected.unit() * axis1) * axis1;
+
+                        if (!perpendicular2)
+                            proj2 = projected.length() / fabs(projected.unit() * axis2) * axis2;
 
-                    assert(totalV != 0);
+                        playerV = std::max(0.0, fabs(axis1 * projected.unit()) * movement1 * axis1 * players.v[i] * (j > 0 ? 1 : -1));
+                        otherV = std::max(0.0, fabs(axis2 * projected.unit()) * movement2 * axis2 * players.v[o] * (j > 0 ? -1 : 1));
+                        totalV = playerV + otherV;
+                        if (totalV > 0.0000000001)
+                            break;
+                    }
+
+                    if (totalV <= 0.0000000001) {
+                        playerV = otherV = 1;
+                        totalV = 2;
+                    }
 
                     if (j > 0)
                         proj1 *= -1;
@@ -297,83 +426,340 @@ void SharedState::update(std::vector<int> inputs) {
                     proj1 *= playerV / totalV * 1.01;
                     proj2 *= otherV / totalV * 1.01;
 
+                    proj1 += 0.0001 * proj1.unit();
+                    proj2 += 0.0001 * proj2.unit();
+
                     assert(!(isnan(proj1.x) || isnan(proj1.y) || isnan(proj2.x) || isnan(proj2.y)));
 
-                    players[i].x += proj1.x;
-                    players[i].y += proj1.y;
+                    player.x += proj1.x;
+                    player.y += proj1.y;
                     other.x += proj2.x;
                     other.y += proj2.y;
 
-                    assert(!players[i].collide(other));
+                    assert(!player.collide(other));
                 }
 
                 if (playerV > 0.0000000001)
-                    players[i].v = 0;
+                    players.v[i] = 0;
                 if (otherV > 0.0000000001)
-                    other.v = 0;
+                    players.v[o] = 0;
             }
+
+            players.x[i] = player.x;
+            players.y[i] = player.y;
+            players.x[o] = other.x;
+            players.y[o] = other.y;
         }
 
         if (haltPlayer)
-            players[i].v = 0;
+            players.v[i] = 0;
     }
 
-    Entity oldBall(ball);
-    ball.update();
-    ball.orientation += ballRotation;
+    // Balls are integrated in one batch. Each ball's path over the step
+    // is then swept against the paddles and walls, and a ball that
+    // would've touched something on the way is moved again from where
+    // it started, stopping at each contact (so fast balls can't pass
+    // through paddles or walls).
+    std::vector<double> startX(balls.x), startY(balls.y);
+    balls.update(STEP);
+    balls.spin(ballRotations, STEP, ballSpins);
+
+    // The grid (or, without the broadphase, a list of every paddle)
+    // gives the paddles each ball might be touching.
+    std::vector<int> candidates;
+    if (broadphase) {
+        std::vector<AABB> paddleBounds(players.size());
+        for (unsigned int i = 0; i < players.size(); i++)
+            paddleBounds[i] = players.getBounds(i, 1);
+        paddleGrid.build(paddleBounds);
+    }
 
-    // TODO: Re-add phasing fix, possibly with line (from paddle
-    // sides) and OBB intersection check (project ball and line on to
-    // perpindicular line).
+    for (unsigned int b = 0; b < balls.size(); b++) {
+        Entity ball(balls[b]);
+        bool anyCollision = false;
+        if (hitSteps[b] < REHIT_STEPS)
+            hitSteps[b]++;
+        bool hit = sweepBall(b, ball, startX[b], startY[b]);
+
+        // Paddles can also move into a ball that's standing still.
+        candidates.clear();
+        if (broadphase) {
+            paddleGrid.query(getBounds(ball, Vector2(0, 0)), candidates);
+        } else {
+            for (unsigned int i = 0; i < players.size(); i++)
+                candidates.push_back(i);
+        }
 
-    bool anyCollision = false;
+        for (int i : candidates) {
+            std::vector<Vector2> projections;
+            bool collision = ball.collide(players[i], &projections);
+            anyCollision |= collision;
 
-    for (unsigned int i = 0; i < players.size(); i++) {
-        std::vector<Vector2> projections;
-        bool collision = ball.collide(players[i], &projections);
-        anyCollision |= collision;
+            if ((collided[b] == -1 || collided[b] != i) && collision) {
+                hitBall(b, ball, i, projections);
+                hit = true;
+            }
+        }
 
-        if ((collided == -1 || collided != (int)i) && collision) {
+        if (collided[b] != -1 && !anyCollision)
+            collided[b] = -1;
+
+        if (hit)
+            balls.set(b, ball);
+    }
+
+    for (double &v : players.v) {
+        if (v > 0)
+            v = clamp(v - PADDLE_FRICTION * STEP, 0, MAX_PADDLE_SPEED);
+        else
+            v = clamp(v + PADDLE_FRICTION * STEP, -MAX_PADDLE_SPEED, 0);
+    }
+
+    // Check for 1) scoring and 2) wall bouncing. Every ball is tested
+    // against every boundary in one batch; only balls that touch a
+    // plain wall (and so need to bounce, which moves them between
+    // boundary tests) go through the sequential checkBoundaries().
+    unsigned int numBalls = balls.size();
+    std::vector<unsigned char> outside(boundaries.size() * numBalls);
+    for (unsigned int i = 0; i < boundaries.size(); i++)
+        balls.testLine(arena.starts[i], boundaries[i], &outside[i * numBalls]);
+
+    for (unsigned int b = 0; b < numBalls; b++) {
+        bool scored = false, bounced = false;
+        bool anyThrough[scores.size()];
+
+        for (unsigned int i = 0; !bounced && i < boundaries.size(); i++) {
+            unsigned char through = outside[i * numBalls + b];
+            int playerIndex = arena.owners[i];
+            if (playerIndex == -1) {
+                bounced = through != 0;
+            } else {
+                anyThrough[playerIndex] = through != 0;
+                if (through == 0xf)
+                    scored = true;
+            }
+        }
+
+        if (bounced) {
+            Entity ball(balls[b]);
+            scored = checkBoundaries(ball, anyThrough);
+            balls.set(b, ball);
+            changeTrajectory(b);
+        }
+
+        if (scored) {
             if (listener != NULL)
-                listener->onHit();
-            if (projections[3].length() < projections[2].length())
-                ball.theta = ball.theta + pi;
-            else 
-                ball.theta = 2*players[i].theta - ball.theta;
-            Vector2 ballDir(cos(ball.theta), sin(ball.theta));
-            Vector2 playerDir(cos(players[i].theta), sin(players[i].theta));
-            double change = ballDir * playerDir * players[i].v / 80;
-            ballRotation = fmod(ballRotation + change, pi/2);
-            if (projections[3].length() < projections[2].length())
-                ball.setDelta(ball.getDX() + players[i].getDX(), ball.getDY() + players[i].getDY());
-            else
-                ball.setDelta(ball.getDX() + players[i].getDX() / 2, ball.getDY() + players[i].getDY() / 2);
-            ball.v *= 1.1;
-            collided = i;
+                listener->onScore(b, balls[b]);
+            resetBall(b);
+
+            for (unsigned int i = 0; i < scores.size(); i++) {
+                if (!anyThrough[i])
+                    scores[i] += 1;
+            }
+        }
+    }
+}
+
+// Moves ball (already integrated to the end of the step) back to
+// (startX, startY) and sweeps it over the step, resolving contacts with
+// paddles and plain walls in the order they happen. Returns false
+// (leaving ball as it was) if nothing is touched along the way.
+bool SharedState::sweepBall(unsigned int b, Entity &ball, double startX, double startY) {
+    // Bounds how much work a single ball can make in one step; any
+    // movement left after this many contacts is dropped.
+    const int maxEvents = 8;
+
+    double endX = ball.x, endY = ball.y;
+    double remaining = 1;
+    std::vector<int> candidates;
+    std::vector<Vector2> projections, bestProjections;
+
+    ball.x = startX;
+    ball.y = startY;
+
+    // Most steps touch nothing: no paddle is near the ball's path, and
+    // since the arena is convex, a ball that ends up inside every wall
+    // never left it.
+    candidates.clear();
+    if (broadphase) {
+        paddleGrid.query(getBounds(ball, Vector2(endX - startX, endY - startY)), candidates);
+    } else {
+        for (unsigned int i = 0; i < players.size(); i++)
+            candidates.push_back(i);
+    }
+
+    bool clear = candidates.empty() || (candidates.size() == 1 && candidates[0] == collided[b]);
+    if (clear) {
+        Entity end(ball);
+        end.x = endX;
+        end.y = endY;
+        std::vector<Vector2> vertices = end.getVertices();
+        for (unsigned int w = 0; clear && w < geometry->walls.size(); w++) {
+            int i = geometry->walls[w];
+            for (const auto &v : vertices) {
+                if (geometry->normals[i] * v <= geometry->offsets[i])
+                    clear = false;
+            }
         }
     }
 
-    if (collided != -1 && !anyCollision)
-        collided = -1;
+    if (clear) {
+        ball.x = endX;
+        ball.y = endY;
+        return false;
+    }
+
+    int event;
+    for (event = 0; event < maxEvents; event++) {
+        Vector2 delta(ball.getDX() * STEP * remaining, ball.getDY() * STEP * remaining);
+        double time = INFINITY, t;
+        int paddle = -1, wall = -1;
+
+        candidates.clear();
+        if (broadphase) {
+            paddleGrid.query(getBounds(ball, delta), candidates);
+        } else {
+            for (unsigned int i = 0; i < players.size(); i++)
+                candidates.push_back(i);
+        }
 
-    for (auto p = players.begin(); p < players.end(); ++p) {
-        if (p->v > 0)
-            p->v = clamp(p->v - .1, 0, 10);
-        else
-            p->v = clamp(p->v + .1, -10, 0);
+        for (int i : candidates) {
+            projections.clear();
+            if (i != collided[b] && ball.sweep(players[i], delta, t, &projections) && t < time) {
+                time = t;
+                paddle = i;
+                bestProjections.swap(projections);
+            }
+        }
+
+        // Walls only need the time the first vertex reaches them.
+        std::vector<Vector2> vertices = ball.getVertices();
+        for (int i : geometry->walls) {
+            const Vector2 &perpendicular = geometry->normals[i];
+            double speed = delta * perpendicular;
+            if (speed >= 0)
+                continue;
+
+            for (const auto &v : vertices) {
+                // Stop a hair short of the wall, so that the ball is
+                // still strictly inside it for the boundary check.
+                t = std::max(0.0, ((v - geometry->starts[i]) * perpendicular - 1e-6) / -speed);
+                if (t <= 1 && t < time) {
+                    time = t;
+                    paddle = -1;
+                    wall = i;
+                }
+            }
+        }
+
+        if (paddle == -1 && wall == -1)
+            break;
+
+        ball.x += delta.x * time;
+        ball.y += delta.y * time;
+        remaining *= 1 - time;
+
+        if (paddle != -1) {
+            hitBall(b, ball, paddle, bestProjections);
+        } else {
+            if (listener != NULL)
+                listener->onBounce();
+            reflect(ball, geometry->normals[wall]);
+            changeTrajectory(b);
+        }
+    }
+
+    if (event == 0) {
+        ball.x = endX;
+        ball.y = endY;
+        return false;
+    }
+
+    if (event < maxEvents) {
+        ball.x += ball.getDX() * STEP * remaining;
+        ball.y += ball.getDY() * STEP * remaining;
+    }
+
+    return true;
+}
+
+// Applies the response to ball b hitting paddle i, given the
+// projections from the collision test.
+void SharedState::hitBall(unsigned int b, Entity &ball, int i, std::vector<Vector2> &projections) {
+    if (listener != NULL)
+        listener->onHit();
+    changeTrajectory(b);
+    // Off an end of the paddle the ball goes straight back; off a face,
+    // it's mirrored about the paddle's axis.
+    Vector2 playerDir(players.cosTheta[i], players.sinTheta[i]);
+    Vector2 ballDir(ball.dx, ball.dy);
+    if (projections[3].length() < projections[2].length())
+        ballDir = -ballDir;
+    else
+        ballDir = 2 * (ballDir * playerDir) * playerDir - ballDir;
+    ball.setDelta(ballDir.x, ballDir.y);
+    collided[b] = i;
+
+    bool rehit = hitSteps[b] < REHIT_STEPS;
+    hitSteps[b] = 0;
+    if (rehit)
+        return;
+
+    double change = ballDir.unit() * playerDir * players.v[i] / 80;
+    if (change != 0) {
+        ballRotations[b] = fmod(ballRotations[b] + change, MAX_SPIN);
+        ballSpins[b] = Vector2(cos(ballRotations[b] * STEP), sin(ballRotations[b] * STEP));
+    }
+    if (projections[3].length() < projections[2].length())
+        ball.setDelta(ball.getDX() + players.getDX(i), ball.getDY() + players.getDY(i));
+    else
+        ball.setDelta(ball.getDX() + players.getDX(i) / 2, ball.getDY() + players.getDY(i) / 2);
+    ball.dx *= 1.1;
+    ball.dy *= 1.1;
+}
+
+void SharedState::changeTrajectory(unsigned int b) {
+    ballTrajectories[b] = ++trajectoryCount;
+}
+
+// Mirrors ball's velocity off a wall with the given (unit) normal.
+void SharedState::reflect(Entity &ball, const Vector2 &normal) {
+    double along = 2 * (ball.dx * normal.x + ball.dy * normal.y);
+    ball.setDelta(ball.dx - along * normal.x, ball.dy - along * normal.y);
+}
+
+// Returns the bounds of ball over a move by delta, padded by a pixel
+// like the paddles' bounds.
+AABB SharedState::getBounds(const Entity &ball, const Vector2 &delta) {
+    std::vector<Vector2> vertices = ball.getVertices();
+    AABB box = { vertices[0].x, vertices[0].y, vertices[0].x, vertices[0].y };
+    for (const auto &v : vertices) {
+        box.minX = std::min<double>(box.minX, std::min(v.x, v.x + delta.x));
+        box.minY = std::min<double>(box.minY, std::min(v.y, v.y + delta.y));
+        box.maxX = std::max<double>(box.maxX, std::max(v.x, v.x + delta.x));
+        box.maxY = std::max<double>(box.maxY, std::max(v.y, v.y + delta.y));
     }
 
+    box.minX -= 1;
+    box.minY -= 1;
+    box.maxX += 1;
+    box.maxY += 1;
+    return box;
+}
+
+// Sequentially checks the ball against each boundary, bouncing it off
+// of walls and recording which players' boundaries it has (partially)
+// gone through; returns true if it's gone all the way through one.
+bool SharedState::checkBoundaries(Entity &ball, bool anyThrough[]) {
     bool scored = false;
-    bool allThrough;
-    bool anyThrough[scores.size()];
+    bool allThrough = false;
 
-    // Check for 1) scoring and 2) wall bouncing.
     for (unsigned int i = 0; i < boundaries.size(); i++) {
-        Vector2& start = boundaries[(boundaries.size()+i-1)%boundaries.size()];
-        Vector2& end = boundaries[i];
+        const Vector2& start = geometry->starts[i];
+        const Vector2& end = boundaries[i];
         std::vector<Vector2> vertices = ball.getVertices();
 
-        int playerIndex = boundaryToPlayerIndex(i);
+        int playerIndex = geometry->owners[i];
         if (playerIndex != -1) {
             allThrough = true;
             anyThrough[playerIndex] = false;
@@ -392,20 +778,21 @@ void SharedState::update(std::vector<int> inputs) {
                     if (!allThrough)
                         break;
                 } else {
-                    listener->onBounce();
-                    Vector2 wall = (end - start).unit();
-                    Vector2 perpendicular(-wall.y, wall.x);
-                    double diff = (start * perpendicular) - (v * perpendicular);
-
-                    Vector2 oldDir(cos(ball.theta), sin(ball.theta));
+                    if (listener != NULL)
+                        listener->onBounce();
+                    const Vector2 &perpendicular = geometry->normals[i];
+                    double diff = geometry->offsets[i] - (v * perpendicular);
+
+                    // Back out along the velocity, then forward the
+                    // same distance along the reflected one.
+                    Vector2 oldDir(ball.dx, ball.dy);
                     oldDir *= diff / (oldDir * perpendicular);
                     ball.x += oldDir.x;
                     ball.y += oldDir.y;
 
-                    double angle = atan2(wall.y, wall.x);
-                    ball.theta = 2*angle - ball.theta;
+                    reflect(ball, perpendicular);
 
-                    Vector2 dir(cos(ball.theta), sin(ball.theta));
+                    Vector2 dir(ball.dx, ball.dy);
                     dir *= diff / (dir * perpendicular);
                     ball.x += dir.x;
                     ball.y += dir.y;
@@ -419,25 +806,80 @@ void SharedState::update(std::vector<int> inputs) {
             scored = true;
     }
 
-    if (scored) {
-        resetBall();
-
-        for (unsigned int i = 0; i < scores.size(); i++) {
-            if (!anyThrough[i])
-                scores[i] += 1;
-        }
-    }
+    return scored;
 }
 
 int SharedState::playerToBoundaryIndex(int playerIndex) const {
-    return (playerBoundaryOffset + (boundaries.size() / players.size()) * playerIndex) % boundaries.size();
+    return geometry->playerEdges[playerIndex];
 }
 
+// Returns -1 for plain walls.
 int SharedState::boundaryToPlayerIndex(int boundaryIndex) const {
-    int val = (boundaries.size() + boundaryIndex - playerBoundaryOffset) % boundaries.size();
-    int wallMult = boundaries.size() / players.size();
-    // Check if it actually represents a player's wall.
-    if ((val % wallMult) != 0)
-        return -1;
-    return val / wallMult;
+    return geometry->owners[boundaryIndex];
+}
+
+static bool bad(double x) {
+    return isnan(x) || isinf(x);
+}
+
+// maxBounces is 50 by default (see SharedState.h).
+bool SharedState::traceBall(unsigned int b, int player, double goalInset, Vector2 &center, double &time, int maxBounces) const {
+    Vector2 corners[4];
+    balls.getVertices(b, corners);
+    Vector2 start = balls.getCenter(b);
+    for (Vector2 &corner : corners)
+        corner -= start;
+
+    double speed = balls.v[b] < 0 ? -balls.v[b] : balls.v[b];
+    Vector2 dir(balls.cosTheta[b], balls.sinTheta[b]);
+    if (balls.v[b] < 0)
+        dir = -dir;
+
+    double distance;
+    if (speed == 0 || !geometry->trace(start, dir, corners, goalInset, geometry->playerEdges[player], maxBounces, center, distance))
+        return false;
+    time = distance / speed;
+    return true;
+}
+
+std::string SharedState::check() const {
+    std::ostringstream problem;
+
+    for (unsigned int i = 0; i < getNumEntities(); i++) {
+        Entity e = getEntity(i);
+        if (bad(e.x) || bad(e.y) || bad(e.dx) || bad(e.dy) || bad(e.getOrientation())) {
+            problem << "entity " << i << " has a non-finite position, velocity or orientation";
+            return problem.str();
+        }
+    }
+
+    // Neighboring paddles should always have been pushed apart.
+    for (unsigned int i = 0; players.size() > 1 && i < players.size(); i++) {
+        unsigned int o = (i + 1) % players.size();
+        if ((players.size() > 2 || i == 0) && players[i].collide(players[o])) {
+            problem << "paddles " << i << " and " << o << " overlap";
+            return problem.str();
+        }
+    }
+
+    // Balls can leave through goals (and are then reset), but never
+    // through a plain wall.
+    for (unsigned int b = 0; b < balls.size(); b++) {
+        Vector2 center = balls.getCenter(b);
+        for (int i : geometry->walls) {
+            if (geometry->normals[i] * center <= geometry->offsets[i]) {
+                problem << "ball " << b << " is outside wall " << i;
+                return problem.str();
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < scores.size(); i++) {
+        if (scores[i] < 0) {
+            problem << "player " << i << " has a negative score";
+            return problem.str();
+        }
+    }
+
+    return problem.str();
 }
@@ -2,34 +2,116 @@
 #ifndef PING_SHARED_STATE_H
 #define PING_SHARED_STATE_H
 
+#include <memory>
+#include <random>
+#include <string>
 #include <vector>
+#include "ArenaGeometry.h"
 #include "StateListener.h"
 #include "Entity.h"
+#include "EntityStore.h"
 
+// Physics runs in fixed steps of 1/PHYSICS_RATE seconds. update() is
+// called tickRate times a second (with that tick's inputs) and runs as
+// many steps as that covers, so the game plays the same at any tick
+// rate. Speeds are per second: pixels for velocities, radians for
+// ballRotations.
 class SharedState {
 public:
+    static const int PHYSICS_RATE = 240;
+    static const int DEFAULT_TICK_RATE = 60;
+
     std::vector<Vector2> boundaries;
-    std::vector<Entity> players;
+    // Rebuilt whenever boundaries change (in reset()/resetClassic()),
+    // and never modified, so copies of the state can share it.
+    std::shared_ptr<const ArenaGeometry> geometry;
+    EntityStore players;
     std::vector<int> scores;
     int playerBoundaryOffset;
-    Entity ball;
+    // Each ball has its own spin and its own "collided" latch (the
+    // index of the paddle it's currently touching, or -1).
+    EntityStore balls;
+    std::vector<double> ballRotations;
+    std::vector<int> collided;
+    // Stamped with a new number whenever a ball's path changes other
+    // than by carrying on along it (it's hit, it bounces, it's reset or
+    // stopped, or it's set with setEntity()), so predictions of where
+    // it's going can be kept until then.
+    std::vector<unsigned long> ballTrajectories;
     StateListener *listener;
-    int collided;
     double centerY, scale;
-    double ballRotation;
+    // Whether to use the spatial grid to find which paddles a ball
+    // might hit (rather than testing every paddle); on by default, and
+    // only worth turning off for comparison.
+    bool broadphase;
 
     SharedState(StateListener *listener=NULL);
     SharedState(int numPlayers, int wallsPerPlayer, StateListener *listener=NULL);
 
-    std::vector<Entity *> getEntities();
+    // Each state has its own random number generator (for where the
+    // balls are served), seeded randomly unless this is called.
+    void seed(unsigned int seed);
+
+    int getTickRate() const;
+    // rate must be between 1 and PHYSICS_RATE.
+    void setTickRate(int rate);
 
-    void resetBall();
-    void resetClassic();
-    void reset(int numPlayers, int wallMult);
+    // Entities [0, balls.size()) are the balls; the rest are players.
+    unsigned int getNumEntities() const;
+    Entity getEntity(unsigned int n) const;
+    void setEntity(unsigned int n, const Entity &entity);
+    // The fastest entity n can be going: a ball's own speed, or the top
+    // speed of a paddle (whose speed isn't sent over the network).
+    double getMaxSpeed(unsigned int n) const;
+
+    void resetBall(unsigned int n);
+    void resetBalls();
+    // Holds every ball where it is (until it's reset).
+    void stopBalls();
+    void resetClassic(int numBalls=1);
+    void reset(int numPlayers, int wallMult, int numBalls=1);
     void update(std::vector<int> inputs);
 
     int playerToBoundaryIndex(int playerIndex) const;
     int boundaryToPlayerIndex(int boundaryIndex) const;
+
+    // Predicts where ball b (turned as it is now) will be as it reaches
+    // player's goal line moved goalInset pixels into the arena,
+    // bouncing off the walls and the other goal lines (moved the same
+    // way) along the way; see ArenaGeometry::trace(). Returns false if
+    // it won't get there within maxBounces bounces; otherwise, sets
+    // center to where the ball's center will be then and time to how
+    // many seconds it'll take.
+    bool traceBall(unsigned int b, int player, double goalInset, Vector2 &center, double &time, int maxBounces=50) const;
+
+    // Returns a description of the first invariant the state breaks
+    // (non-finite values, overlapping paddles, a ball outside a wall,
+    // a negative score), or an empty string if it breaks none.
+    std::string check() const;
+
+private:
+    int tickRate;
+    // Carried between updates when steps don't divide evenly into
+    // ticks; a step runs whenever this reaches tickRate.
+    int stepCredit;
+    // The last number given to ballTrajectories; it's never reused,
+    // even across resets.
+    unsigned long trajectoryCount;
+    std::minstd_rand rng;
+    SpatialGrid paddleGrid;
+    // The cosine and sine of each ball's rotation, so that spinning the
+    // balls every step doesn't need any trig.
+    std::vector<Vector2> ballSpins;
+    // Steps since each ball was last hit (up to REHIT_STEPS).
+    std::vector<int> hitSteps;
+
+    void step(const std::vector<int> &inputs);
+    void changeTrajectory(unsigned int b);
+    bool sweepBall(unsigned int b, Entity &ball, double startX, double startY);
+    void hitBall(unsigned int b, Entity &ball, int i, std::vector<Vector2> &projections);
+    static void reflect(Entity &ball, const Vector2 &normal);
+    static AABB getBounds(const Entity &ball, const Vector2 &delta);
+    bool checkBoundaries(Entity &ball, bool anyThrough[]);
 };
 
 #endif
@@ -0,0 +1,749 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+#include "SharedState.h"
+#include "AIInput.h"
+#include "LearnedInput.h"
+#include "ThreadPool.h"
+#include "utility.h"
+
+// Runs AI-vs-AI matches without a window, as fast as possible, checking
+// the state for problems after every tick. Matches are independent and
+// spread across a thread pool; each one is seeded from its index, so
+// the results don't depend on the number of threads. Useful as a soak
+// test (lots of long matches), as a throughput baseline (one thread),
+// and for tuning (the aggregated score, rally and speed statistics).
+// It also trains LearnedModels (see train()), and runs tournaments
+// between AIs (see tournament()).
+
+typedef std::chrono::steady_clock Clock;
+
+// One side of a match, in a tournament or in training: a LearnedModel
+// if model is set, and otherwise the AI at difficulty.
+struct Contestant {
+    std::string name;
+    AIInput::Difficulty difficulty;
+    const LearnedModel *model;
+};
+
+struct MatchConfig {
+    bool classic;
+    int numPlayers, wallsPerPlayer, numBalls;
+    // -1 for a mix of EASY to HARD (INSANE is left out, since it's
+    // much slower, and its moves depend on the time it has).
+    int difficulty;
+    int tickRate;
+    long long ticks;
+    // How long (in microseconds) INSANE may plan each move for, unless
+    // it's set to try a fixed number of rollouts (see RolloutPlanner).
+    int budget, rollouts;
+    // If sides[i % 2] is set, seat i is played by it rather than by
+    // the AI at difficulty.
+    const Contestant *sides[2];
+};
+
+// Everything recorded about one match.
+struct MatchResult {
+    long long ticks, hits, bounces;
+    double seconds;
+    std::vector<int> scores;
+    // How many ticks each point lasted, and the ball's speed as it
+    // scored.
+    std::vector<long long> rallies;
+    std::vector<double> speeds;
+    // The first invariant the match broke (if any), and when.
+    std::string problem;
+    long long problemTick;
+    // How many moves each side (even seats and odd seats) made, and
+    // the CPU time they took to decide them (the match's thread's, and
+    // INSANE's planners' on their pool's threads), and the wall time
+    // (which INSANE's threads hide much of, and other matches running
+    // at the same time add to). They're timed a side at a time, so the
+    // clocks' own cost is spread over the side's seats.
+    long long decisions[2];
+    double decisionSeconds[2], decisionWallSeconds[2];
+
+    MatchResult()
+        : ticks(0), hits(0), bounces(0), seconds(0), problemTick(-1), decisions(), decisionSeconds(), decisionWallSeconds() {}
+};
+
+class MatchListener : public StateListener {
+public:
+    long long tick;
+
+    MatchListener(MatchResult &result, int numBalls) : tick(0), result(result), served(numBalls, 0) {}
+
+    void onBounce() { result.bounces++; }
+    void onHit() { result.hits++; }
+
+    void onScore(unsigned int n, const Entity &ball) {
+        result.rallies.push_back(tick + 1 - served[n]);
+        result.speeds.push_back(ball.getV());
+        served[n] = tick + 1;
+    }
+
+private:
+    MatchResult &result;
+    // The tick each ball was last served on.
+    std::vector<long long> served;
+};
+
+static AIInput::Difficulty getDifficulty(const MatchConfig &config, int player) {
+    return (AIInput::Difficulty)(config.difficulty >= 0 ? config.difficulty : player % (AIInput::HARD + 1));
+}
+
+static const char *getSeatName(const MatchConfig &config, int player) {
+    const Contestant *side = config.sides[player % 2];
+    return side != NULL ? side->name.c_str() : AIInput::DIFFICULTY_STRS[getDifficulty(config, player)];
+}
+
+static void resetState(const MatchConfig &config, unsigned int seed, SharedState &state) {
+    state.seed(seed);
+    if (config.classic)
+        state.resetClassic(config.numBalls);
+    else
+        state.reset(config.numPlayers, config.wallsPerPlayer, config.numBalls);
+    state.setTickRate(config.tickRate);
+}
+
+static void runMatch(const MatchConfig &config, unsigned int seed, MatchResult &result) {
+    MatchListener listener(result, config.numBalls);
+    SharedState state(&listener);
+    resetState(config, seed, state);
+
+    std::vector<std::unique_ptr<PaddleInput>> inputs;
+    // The AIs among inputs (or NULL), for their planners' CPU time.
+    std::vector<const AIInput *> ais;
+    for (unsigned int i = 0; i < state.players.size(); i++) {
+        const Contestant *side = config.sides[i % 2];
+        if (side != NULL && side->model != NULL) {
+            inputs.emplace_back(new LearnedInput(*side->model));
+            ais.push_back(NULL);
+        } else {
+            AIInput *ai = new AIInput(side != NULL ? side->difficulty : getDifficulty(config, i),
+                                      RolloutPlanner(config.budget, config.rollouts));
+            inputs.emplace_back(ai);
+            ais.push_back(ai);
+        }
+    }
+
+    std::vector<int> moves(state.players.size());
+
+    Clock::time_point start = Clock::now();
+    for (listener.tick = 0; listener.tick < config.ticks; listener.tick++) {
+        for (int side = 0; side < 2; side++) {
+            Clock::time_point deciding = Clock::now();
+            double cpu = threadCPUSeconds(), helpers = 0;
+            for (unsigned int i = side; i < inputs.size(); i += 2) {
+                if (ais[i] != NULL)
+                    helpers -= ais[i]->getHelperSeconds();
+                moves[i] = inputs[i]->update(state, i);
+                if (ais[i] != NULL)
+                    helpers += ais[i]->getHelperSeconds();
+            }
+            result.decisionSeconds[side] += threadCPUSeconds() - cpu + helpers;
+            result.decisionWallSeconds[side] += std::chrono::duration<double>(Clock::now() - deciding).count();
+            result.decisions[side] += (inputs.size() + 1 - side) / 2;
+        }
+        state.update(moves);
+
+        result.problem = state.check();
+        if (!result.problem.empty()) {
+            result.problemTick = listener.tick++;
+            break;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.ticks = listener.tick;
+    result.scores = state.scores;
+}
+
+// Prints the mean, median, 90th percentile and maximum of values.
+template <class T>
+static void printDistribution(const char *name, std::vector<T> values, double scale, const char *units) {
+    std::cout << std::left << std::setw(16) << name << std::right;
+    if (values.empty()) {
+        std::cout << "none" << std::endl;
+        return;
+    }
+
+    std::sort(values.begin(), values.end());
+    double total = 0;
+    for (T value : values)
+        total += value;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "mean " << total / values.size() * scale
+              << ", median " << values[values.size() / 2] * scale
+              << ", p90 " << values[values.size() * 9 / 10] * scale
+              << ", max " << values.back() * scale;
+    if (*units)
+        std::cout << " " << units;
+    std::cout << " (" << values.size() << ")" << std::endl;
+}
+
+// Training starts by imitating HARD: matches of HARD against itself are
+// sampled every SAMPLE_INTERVAL ticks for LearnedInput's features and
+// HARD's moves, and the model is fitted to those by gradient descent.
+// (A model loaded from the output file skips this, and carries on from
+// where it left off.) Then it improves by self-play: each generation,
+// a randomly perturbed copy plays the model, and replaces it if it
+// scores more. Models are always played quantized, as they'll be once
+// saved, with the samples as the quantization's calibration data.
+static const int SAMPLE_INTERVAL = 4;
+static const int EPOCHS = 20;
+static const double LEARNING_RATE = .01;
+static const double INITIAL_WEIGHTS = .5;
+static const double MUTATION = .05;
+
+typedef std::pair<LearnedModel::Features, int> Sample;
+
+static void collectSamples(const MatchConfig &config, unsigned int seed, std::vector<Sample> &samples) {
+    SharedState state;
+    resetState(config, seed, state);
+
+    // Only used for its features, so the model doesn't matter.
+    LearnedModel model;
+    std::vector<AIInput> ais(state.players.size(), AIInput(AIInput::HARD));
+    std::vector<LearnedInput> learned(state.players.size(), LearnedInput(model));
+    std::vector<int> moves(state.players.size());
+
+    for (long long tick = 0; tick < config.ticks; tick++) {
+        for (unsigned int i = 0; i < ais.size(); i++) {
+            moves[i] = ais[i].update(state, i);
+            if (tick % SAMPLE_INTERVAL == 0)
+                samples.push_back(Sample(learned[i].getFeatures(state, i), moves[i]));
+        }
+        state.update(moves);
+    }
+}
+
+// Plays first against second (either of which can be NULL for the
+// AI), each match twice with the seats swapped, and returns how many
+// more points per seat first scored.
+static double compare(const MatchConfig &config, const Contestant *first, const Contestant *second, int matches, unsigned int seed,
+                      ThreadPool &pool) {
+    MatchConfig configs[2] = { config, config };
+    configs[0].sides[0] = configs[1].sides[1] = first;
+    configs[0].sides[1] = configs[1].sides[0] = second;
+
+    std::vector<MatchResult> results(2 * matches);
+    for (int match = 0; match < 2 * matches; match++)
+        pool.submit([&configs, &results, seed, match] { runMatch(configs[match % 2], seed + match / 2, results[match]); });
+    pool.wait();
+
+    double points[2] = { 0, 0 }, seats[2] = { 0, 0 };
+    for (int match = 0; match < 2 * matches; match++) {
+        for (unsigned int i = 0; i < results[match].scores.size(); i++) {
+            // Whether seat i was first's.
+            int side = (int)(i % 2) != match % 2;
+            points[side] += results[match].scores[i];
+            seats[side]++;
+        }
+    }
+    return points[0] / seats[0] - points[1] / seats[1];
+}
+
+static bool train(MatchConfig config, int matches, unsigned int seed, int generations, const std::string &path, bool quiet, ThreadPool &pool) {
+    std::minstd_rand rng(seed);
+    config.difficulty = AIInput::HARD;
+    config.sides[0] = config.sides[1] = NULL;
+
+    std::vector<std::vector<Sample>> matchSamples(matches);
+    for (int match = 0; match < matches; match++)
+        pool.submit([&config, &matchSamples, seed, match] { collectSamples(config, seed + match, matchSamples[match]); });
+    pool.wait();
+
+    std::vector<Sample> samples;
+    std::vector<LearnedModel::Features> features;
+    for (const std::vector<Sample> &some : matchSamples)
+        samples.insert(samples.end(), some.begin(), some.end());
+    for (const Sample &sample : samples)
+        features.push_back(sample.first);
+
+    LearnedModel model;
+    if (model.load(path)) {
+        std::cout << "continuing from " << path << std::endl;
+    } else {
+        model.randomize(rng, INITIAL_WEIGHTS);
+        for (int epoch = 0; epoch < EPOCHS; epoch++) {
+            std::shuffle(samples.begin(), samples.end(), rng);
+            for (const Sample &sample : samples)
+                model.train(sample.first, sample.second, LEARNING_RATE);
+        }
+    }
+    model.quantize(features);
+
+    int agreed = 0;
+    for (const Sample &sample : samples)
+        agreed += model.play(sample.first) == sample.second;
+    std::cout << samples.size() << " samples; the model makes HARD's move " << std::fixed << std::setprecision(1)
+              << 100.0 * agreed / samples.size() << "% of the time" << std::endl;
+
+    int kept = 0;
+    for (int generation = 0; generation < generations; generation++) {
+        LearnedModel candidate = model;
+        candidate.randomize(rng, MUTATION);
+        candidate.quantize(features);
+
+        Contestant challenger = { "Candidate", AIInput::HARD, &candidate }, incumbent = { "Model", AIInput::HARD, &model };
+        double margin = compare(config, &challenger, &incumbent, matches, seed + (generation + 1) * matches, pool);
+        if (margin > 0) {
+            model = candidate;
+            kept++;
+        }
+        if (!quiet)
+            std::cout << "generation " << generation << ": " << std::showpos << std::setprecision(2) << margin << std::noshowpos
+                      << " points per seat" << (margin > 0 ? " (kept)" : "") << std::endl;
+    }
+
+    Contestant learned = { "Learned", AIInput::HARD, &model };
+    double margin = compare(config, &learned, NULL, matches, seed + (generations + 1) * matches, pool);
+    std::cout << kept << " of " << generations << " generations kept; against HARD, the model scores "
+              << std::showpos << std::setprecision(2) << margin << std::noshowpos << " points per seat" << std::endl;
+
+    if (!model.save(path)) {
+        std::cerr << "couldn't write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// A tournament plays every pair of contestants against each other in
+// each of TOURNAMENT_ARENAS, on alternate seats, with each match played
+// twice (the second time with the seats swapped). A match goes to the
+// side that scores more points per seat. Elo ratings are fitted to all
+// of the results at once (so the order they came in doesn't matter),
+// with 95% confidence intervals from resampling the matches.
+struct TournamentArena {
+    const char *name;
+    bool classic;
+    int numPlayers, wallsPerPlayer;
+};
+
+static const TournamentArena TOURNAMENT_ARENAS[] = {
+    { "classic", true, 2, 2 }, { "2x2", false, 2, 2 }, { "3x1", false, 3, 1 },
+    { "4x1", false, 4, 1 }, { "5x1", false, 5, 1 }, { "6x2", false, 6, 2 }
+};
+static const int NUM_TOURNAMENT_ARENAS = sizeof(TOURNAMENT_ARENAS) / sizeof(TOURNAMENT_ARENAS[0]);
+static const int BOOTSTRAP_SAMPLES = 1000;
+static const int ELO_ITERATIONS = 1000;
+
+// A tournament match's outcome for contestant a: 1 for a win, .5 for a
+// draw and 0 for a loss.
+struct TournamentGame {
+    int a, b;
+    double score;
+};
+
+// Elo's expected scores are the Bradley-Terry model's, whose strengths
+// are fitted here by minorization-maximization. Each pair of
+// contestants is given one extra drawn game, so that one that wins (or
+// loses) everything still gets a finite rating. Ratings average 1500.
+static std::vector<double> fitElo(int numContestants, const std::vector<TournamentGame> &games) {
+    std::vector<double> wins(numContestants, (numContestants - 1) * .5);
+    std::vector<std::vector<double>> played(numContestants, std::vector<double>(numContestants, 1));
+    for (const TournamentGame &game : games) {
+        played[game.a][game.b]++;
+        played[game.b][game.a]++;
+        wins[game.a] += game.score;
+        wins[game.b] += 1 - game.score;
+    }
+
+    std::vector<double> strengths(numContestants, 1), next(numContestants);
+    for (int iteration = 0; iteration < ELO_ITERATIONS; iteration++) {
+        double logTotal = 0;
+        for (int i = 0; i < numContestants; i++) {
+            double total = 0;
+            for (int j = 0; j < numContestants; j++) {
+                if (j != i)
+                    total += played[i][j] / (strengths[i] + strengths[j]);
+            }
+            next[i] = wins[i] / total;
+            logTotal += log(next[i]);
+        }
+        for (int i = 0; i < numContestants; i++)
+            strengths[i] = next[i] / exp(logTotal / numContestants);
+    }
+
+    std::vector<double> ratings(numContestants);
+    for (int i = 0; i < numContestants; i++)
+        ratings[i] = 1500 + 400 * log10(strengths[i]);
+    return ratings;
+}
+
+static bool tournament(MatchConfig config, int matches, unsigned int seed, const std::vector<Contestant> &contestants,
+                       const std::string &path, bool quiet, ThreadPool &pool) {
+    int numContestants = contestants.size();
+
+    // Every pairing in every arena, both ways round.
+    struct Pairing {
+        int arena, a, b;
+    };
+    std::vector<Pairing> pairings;
+    std::vector<MatchConfig> configs;
+    for (int arena = 0; arena < NUM_TOURNAMENT_ARENAS; arena++) {
+        for (int a = 0; a < numContestants; a++) {
+            for (int b = a + 1; b < numContestants; b++) {
+                for (int swap = 0; swap < 2; swap++) {
+                    MatchConfig pairingConfig = config;
+                    pairingConfig.classic = TOURNAMENT_ARENAS[arena].classic;
+                    pairingConfig.numPlayers = TOURNAMENT_ARENAS[arena].numPlayers;
+                    pairingConfig.wallsPerPlayer = TOURNAMENT_ARENAS[arena].wallsPerPlayer;
+                    pairingConfig.sides[swap] = &contestants[a];
+                    pairingConfig.sides[1 - swap] = &contestants[b];
+                    configs.push_back(pairingConfig);
+                }
+                Pairing pairing = { arena, a, b };
+                pairings.push_back(pairing);
+            }
+        }
+    }
+
+    // Matches are seeded by their number within the pairing, so that
+    // every pairing sees the same serves.
+    std::vector<MatchResult> results(configs.size() * matches);
+    for (unsigned int c = 0; c < configs.size(); c++) {
+        for (int match = 0; match < matches; match++) {
+            MatchResult &result = results[c * matches + match];
+            const MatchConfig &pairingConfig = configs[c];
+            pool.submit([&pairingConfig, &result, seed, match] { runMatch(pairingConfig, seed + match, result); });
+        }
+    }
+    pool.wait();
+
+    struct Tally {
+        int wins, draws, losses;
+        double points[2];
+    };
+    std::vector<Tally> tallies(pairings.size(), Tally());
+    std::vector<TournamentGame> games;
+    std::vector<long long> decisions(numContestants, 0);
+    std::vector<double> decisionSeconds(numContestants, 0), decisionWallSeconds(numContestants, 0);
+    int failures = 0;
+
+    for (unsigned int c = 0; c < configs.size(); c++) {
+        const Pairing &pairing = pairings[c / 2];
+        Tally &tally = tallies[c / 2];
+        // Which side (even or odd seats) each contestant was on.
+        int sides[2] = { (int)(c % 2), 1 - (int)(c % 2) };
+        int contestantIds[2] = { pairing.a, pairing.b };
+
+        for (int match = 0; match < matches; match++) {
+            const MatchResult &result = results[c * matches + match];
+            if (!result.problem.empty()) {
+                failures++;
+                std::cout << TOURNAMENT_ARENAS[pairing.arena].name << " " << contestants[pairing.a].name << " vs. "
+                          << contestants[pairing.b].name << " (seed " << seed + match << "): tick " << result.problemTick
+                          << ": " << result.problem << std::endl;
+            }
+
+            double points[2] = { 0, 0 }, seats[2] = { 0, 0 };
+            for (unsigned int i = 0; i < result.scores.size(); i++) {
+                points[i % 2] += result.scores[i];
+                seats[i % 2]++;
+            }
+            double a = points[sides[0]] / seats[sides[0]], b = points[sides[1]] / seats[sides[1]];
+            tally.points[0] += a / (2 * matches);
+            tally.points[1] += b / (2 * matches);
+
+            TournamentGame game = { pairing.a, pairing.b, a > b ? 1 : (a < b ? 0 : .5) };
+            games.push_back(game);
+            tally.wins += a > b;
+            tally.draws += a == b;
+            tally.losses += a < b;
+
+            for (int side = 0; side < 2; side++) {
+                decisions[contestantIds[side]] += result.decisions[sides[side]];
+                decisionSeconds[contestantIds[side]] += result.decisionSeconds[sides[side]];
+                decisionWallSeconds[contestantIds[side]] += result.decisionWallSeconds[sides[side]];
+            }
+        }
+    }
+
+    std::vector<double> ratings = fitElo(numContestants, games);
+    std::vector<std::vector<double>> resampled(numContestants);
+    std::minstd_rand rng(seed);
+    std::uniform_int_distribution<int> pick(0, games.size() - 1);
+    std::vector<TournamentGame> sample(games.size());
+    for (int b = 0; b < BOOTSTRAP_SAMPLES; b++) {
+        for (TournamentGame &game : sample)
+            game = games[pick(rng)];
+        std::vector<double> sampleRatings = fitElo(numContestants, sample);
+        for (int i = 0; i < numContestants; i++)
+            resampled[i].push_back(sampleRatings[i]);
+    }
+
+    std::vector<double> low(numContestants), high(numContestants), nsPerDecision(numContestants), wallNsPerDecision(numContestants);
+    for (int i = 0; i < numContestants; i++) {
+        std::sort(resampled[i].begin(), resampled[i].end());
+        low[i] = resampled[i][BOOTSTRAP_SAMPLES * 25 / 1000];
+        high[i] = resampled[i][BOOTSTRAP_SAMPLES * 975 / 1000 - 1];
+        nsPerDecision[i] = decisions[i] > 0 ? decisionSeconds[i] * 1e9 / decisions[i] : 0;
+        wallNsPerDecision[i] = decisions[i] > 0 ? decisionWallSeconds[i] * 1e9 / decisions[i] : 0;
+    }
+
+    if (!quiet) {
+        for (unsigned int p = 0; p < pairings.size(); p++) {
+            const Tally &tally = tallies[p];
+            std::cout << std::left << std::setw(8) << TOURNAMENT_ARENAS[pairings[p].arena].name
+                      << std::setw(20) << contestants[pairings[p].a].name + " vs. " + contestants[pairings[p].b].name << std::right
+                      << tally.wins << "-" << tally.draws << "-" << tally.losses << std::fixed << std::setprecision(2)
+                      << " (" << tally.points[0] << " to " << tally.points[1] << " points per seat)" << std::endl;
+        }
+    }
+    std::cout << std::left << std::setw(12) << "contestant" << std::setw(24) << "Elo (95% CI)" << std::setw(20) << "CPU ns/decision"
+              << "wall ns/decision" << std::right << std::endl;
+    for (int i = 0; i < numContestants; i++) {
+        std::ostringstream elo, cpu;
+        elo << std::fixed << std::setprecision(0) << ratings[i] << " (" << low[i] << " to " << high[i] << ")";
+        cpu << std::fixed << std::setprecision(1) << nsPerDecision[i];
+        std::cout << std::left << std::setw(12) << contestants[i].name << std::setw(24) << elo.str() << std::setw(20) << cpu.str()
+                  << std::right << std::fixed << std::setprecision(1) << wallNsPerDecision[i] << std::endl;
+    }
+    std::cout << failures << " matches failed invariant checks" << std::endl;
+
+    // One value per line, in a fixed order, so that reports diff cleanly;
+    // times are left out, as they change from run to run.
+    std::ofstream out(path);
+    out << std::fixed << "{" << std::endl
+        << "  \"matches\": " << matches << "," << std::endl
+        << "  \"ticks\": " << config.ticks << "," << std::endl
+        << "  \"tickRate\": " << config.tickRate << "," << std::endl
+        << "  \"balls\": " << config.numBalls << "," << std::endl
+        << "  \"seed\": " << seed << "," << std::endl
+        << "  \"failures\": " << failures << "," << std::endl
+        << "  \"contestants\": [" << std::endl;
+    for (int i = 0; i < numContestants; i++) {
+        out << "    {" << std::endl
+            << "      \"name\": \"" << contestants[i].name << "\"," << std::endl
+            << std::setprecision(1)
+            << "      \"elo\": " << ratings[i] << "," << std::endl
+            << "      \"eloLow\": " << low[i] << "," << std::endl
+            << "      \"eloHigh\": " << high[i] << "," << std::endl
+            << "      \"decisions\": " << decisions[i] << std::endl
+            << "    }" << (i + 1 < numContestants ? "," : "") << std::endl;
+    }
+    out << "  ]," << std::endl
+        << "  \"pairings\": [" << std::endl;
+    for (unsigned int p = 0; p < pairings.size(); p++) {
+        const Tally &tally = tallies[p];
+        out << "    {" << std::endl
+            << "      \"arena\": \"" << TOURNAMENT_ARENAS[pairings[p].arena].name << "\"," << std::endl
+            << "      \"a\": \"" << contestants[pairings[p].a].name << "\"," << std::endl
+            << "      \"b\": \"" << contestants[pairings[p].b].name << "\"," << std::endl
+            << "      \"wins\": " << tally.wins << "," << std::endl
+            << "      \"draws\": " << tally.draws << "," << std::endl
+            << "      \"losses\": " << tally.losses << "," << std::endl
+            << std::setprecision(3)
+            << "      \"pointsA\": " << tally.points[0] << "," << std::endl
+            << "      \"pointsB\": " << tally.points[1] << std::endl
+            << "    }" << (p + 1 < pairings.size() ? "," : "") << std::endl;
+    }
+    out << "  ]" << std::endl
+        << "}" << std::endl;
+
+    if (!out) {
+        std::cerr << "couldn't write " << path << std::endl;
+        return false;
+    }
+    return failures == 0;
+}
+
+static void usage() {
+    std::cerr << "usage: ./ping-sim [number of players (defaults to 2)] [walls per player (defaults to 2)]" << std::endl
+              << "                  [--classic (-c)] [--balls (-b) number of balls]" << std::endl
+              << "                  [--matches (-m) number of matches (defaults to 10)]" << std::endl
+              << "                  [--rate (-r) ticks per second (defaults to " << SharedState::DEFAULT_TICK_RATE << ")]" << std::endl
+              << "                  [--ticks (-t) ticks per match (defaults to 10 minutes of play)]" << std::endl
+              << "                  [--difficulty (-d) easy|medium|hard|insane|mixed (defaults to mixed, of easy to hard)]" << std::endl
+              << "                  [--budget microseconds insane may plan each move for (defaults to "
+              << RolloutPlanner::DEFAULT_BUDGET << ")]" << std::endl
+              << "                  [--rollouts number of plans insane tries for each move, however long they" << std::endl
+              << "                  take, instead of a time budget (so that its matches repeat)]" << std::endl
+              << "                  [--threads (-j) number of threads (defaults to 0, one per core)]" << std::endl
+              << "                  [--seed (-s) random seed] [--quiet (-q)]" << std::endl
+              << "                  [--model (-M) file to play every other seat with]" << std::endl
+              << "                  [--train file to train a model into] [--generations (-g) number of" << std::endl
+              << "                  self-play generations to train for (defaults to 50)]" << std::endl
+              << "                  [--tournament file to write a round-robin tournament's report to" << std::endl
+              << "                  (between easy to hard, insane if --rollouts is given, and the model if" << std::endl
+              << "                  there is one)]" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    MatchConfig config = { false, 2, 2, 1, -1, SharedState::DEFAULT_TICK_RATE, -1, RolloutPlanner::DEFAULT_BUDGET, 0, { NULL, NULL } };
+    bool quiet = false;
+    int matches = 10, threads = 0, generations = 50;
+    std::string modelPath, trainPath, tournamentPath;
+    unsigned int seed = 1;
+    std::vector<int> args;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--classic") == 0)
+            config.classic = true;
+        else if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--quiet") == 0)
+            quiet = true;
+        else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--balls") == 0) && hasValue)
+            config.numBalls = std::stoi(argv[++i]);
+        else if ((strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--matches") == 0) && hasValue)
+            matches = std::stoi(argv[++i]);
+        else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--rate") == 0) && hasValue)
+            config.tickRate = std::stoi(argv[++i]);
+        else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--ticks") == 0) && hasValue)
+            config.ticks = std::stoll(argv[++i]);
+        else if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--threads") == 0) && hasValue)
+            threads = std::stoi(argv[++i]);
+        else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--seed") == 0) && hasValue)
+            seed = std::stoul(argv[++i]);
+        else if ((strcmp(argv[i], "-g") == 0 || strcmp(argv[i], "--generations") == 0) && hasValue)
+            generations = std::stoi(argv[++i]);
+        else if ((strcmp(argv[i], "-M") == 0 || strcmp(argv[i], "--model") == 0) && hasValue)
+            modelPath = argv[++i];
+        else if (strcmp(argv[i], "--train") == 0 && hasValue)
+            trainPath = argv[++i];
+        else if (strcmp(argv[i], "--tournament") == 0 && hasValue)
+            tournamentPath = argv[++i];
+        else if (strcmp(argv[i], "--budget") == 0 && hasValue)
+            config.budget = std::stoi(argv[++i]);
+        else if (strcmp(argv[i], "--rollouts") == 0 && hasValue)
+            config.rollouts = std::stoi(argv[++i]);
+        else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--difficulty") == 0) && hasValue) {
+            std::string name = argv[++i];
+            config.difficulty = -2;
+            for (int d = 0; d < AIInput::NUM_DIFFICULTY; d++) {
+                if (strcasecmp(name.c_str(), AIInput::DIFFICULTY_STRS[d]) == 0)
+                    config.difficulty = d;
+            }
+            if (name == "mixed")
+                config.difficulty = -1;
+            if (config.difficulty == -2) {
+                usage();
+                return 1;
+            }
+        } else if (isdigit(argv[i][0]))
+            args.push_back(std::stoi(argv[i]));
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    if (config.classic) {
+        config.numPlayers = config.wallsPerPlayer = 2;
+    } else {
+        if (args.size() > 0)
+            config.numPlayers = args[0];
+        if (args.size() > 1)
+            config.wallsPerPlayer = args[1];
+    }
+
+    if (config.ticks == -1)
+        config.ticks = 600LL * config.tickRate;
+
+    if (config.numPlayers < 1 || config.wallsPerPlayer < 1 || config.numBalls < 1 || matches < 1 || config.ticks < 1 || threads < 0 ||
+        config.tickRate < 1 || config.tickRate > SharedState::PHYSICS_RATE || generations < 0 || config.budget < 0 || config.rollouts < 0) {
+        usage();
+        return 1;
+    }
+
+    LearnedModel model;
+    Contestant learned = { "Learned", AIInput::HARD, &model };
+    if (!modelPath.empty()) {
+        if (!model.load(modelPath)) {
+            std::cerr << "couldn't load a model from " << modelPath << std::endl;
+            return 1;
+        }
+        config.sides[0] = &learned;
+    }
+
+    std::vector<MatchResult> results(matches);
+
+    Clock::time_point start = Clock::now();
+    ThreadPool pool(threads);
+    if (!trainPath.empty())
+        return train(config, matches, seed, generations, trainPath, quiet, pool) ? 0 : 1;
+
+    if (!tournamentPath.empty()) {
+        // INSANE's moves depend on how much time it gets, unless it's
+        // given a number of rollouts, so it's left out otherwise (as
+        // the report is meant to be the same from run to run).
+        std::vector<Contestant> contestants;
+        for (int d = 0; d <= (config.rollouts > 0 ? AIInput::INSANE : AIInput::HARD); d++) {
+            Contestant ai = { AIInput::DIFFICULTY_STRS[d], (AIInput::Difficulty)d, NULL };
+            contestants.push_back(ai);
+        }
+        if (!modelPath.empty())
+            contestants.push_back(learned);
+        return tournament(config, matches, seed, contestants, tournamentPath, quiet, pool) ? 0 : 1;
+    }
+
+    for (int match = 0; match < matches; match++)
+        pool.submit([&config, &results, seed, match] { runMatch(config, seed + match, results[match]); });
+    pool.wait();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    long long totalTicks = 0, hits = 0, bounces = 0;
+    double busySeconds = 0;
+    int failures = 0;
+    std::vector<long long> goals, rallies;
+    std::vector<double> speeds;
+    std::vector<std::vector<int>> seatScores(config.numPlayers);
+
+    for (int match = 0; match < matches; match++) {
+        const MatchResult &result = results[match];
+        totalTicks += result.ticks;
+        busySeconds += result.seconds;
+        hits += result.hits;
+        bounces += result.bounces;
+        rallies.insert(rallies.end(), result.rallies.begin(), result.rallies.end());
+        speeds.insert(speeds.end(), result.speeds.begin(), result.speeds.end());
+
+        // Each goal gives a point to every seat but the one scored
+        // on, so goals are counted as they happen (a rally each), not
+        // from the scores.
+        long long matchGoals = result.rallies.size();
+        for (unsigned int i = 0; i < result.scores.size(); i++)
+            seatScores[i].push_back(result.scores[i]);
+        goals.push_back(matchGoals);
+
+        if (!result.problem.empty()) {
+            failures++;
+            std::cout << "match " << match << " (seed " << seed + match << "): tick " << result.problemTick
+                      << ": " << result.problem << std::endl;
+        } else if (!quiet) {
+            std::cout << "match " << match << ": " << matchGoals << " goals" << std::endl;
+        }
+    }
+
+    double perSecond = totalTicks / seconds, perThreadSecond = totalTicks / busySeconds;
+    unsigned int busyThreads = std::min(pool.size(), (unsigned int)matches);
+    std::cout << matches << " matches, " << totalTicks << " ticks, " << hits << " hits, " << bounces << " bounces" << std::endl;
+
+    printDistribution("goals/match", goals, 1, "");
+    for (int i = 0; i < config.numPlayers; i++) {
+        std::ostringstream name;
+        name << "player " << i << " (" << getSeatName(config, i)[0] << ")";
+        printDistribution(name.str().c_str(), seatScores[i], 1, "points");
+    }
+    printDistribution("rally length", rallies, 1.0 / config.tickRate, "s");
+    printDistribution("scoring speed", speeds, 1, "px/s");
+
+    std::cout << std::fixed << std::setprecision(0) << perSecond << " ticks/s on " << pool.size() << " threads ("
+              << std::setprecision(1) << perSecond / config.tickRate << "x real time; "
+              << std::setprecision(0) << perThreadSecond << " ticks/s per busy thread, "
+              << std::setprecision(0) << 100 * perSecond / (perThreadSecond * busyThreads) << "% scaling)" << std::endl
+              << failures << " matches failed invariant checks" << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
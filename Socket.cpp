@@ -1,7 +1,8 @@
+#include <string.h>
 #include "Socket.h"
 #include "utility.h"
 
-Socket::Socket(TCPsocket sock) : error(false), sock(sock) {
+Socket::Socket(TCPsocket sock) : error(false), received(0), sent(0), sock(sock) {
     set = SDLNet_AllocSocketSet(1);
     if (set == NULL)
         error = true;
@@ -24,24 +25,40 @@ char Socket::getByte() {
     char buffer[1];
     if (SDLNet_TCP_Recv(sock, buffer, 1) < 1)
         error = true;
+    received += 1;
     return buffer[0];
 }
 
+Uint16 Socket::getUint16() {
+    char buffer[2];
+    if (SDLNet_TCP_Recv(sock, buffer, 2) < 2)
+        error = true;
+    received += 2;
+    return SDLNet_Read16(buffer);
+}
+
 Uint64 Socket::getUint64() {
     char buffer[8];
     if (SDLNet_TCP_Recv(sock, buffer, 8) < 8)
         error = true;
-    return ntoh64(*(Uint64 *)buffer);
+    received += 8;
+    Uint64 val;
+    memcpy(&val, buffer, sizeof(val));
+    return ntoh64(val);
 }
 
 double Socket::getDouble() {
     char buffer[8];
     if (SDLNet_TCP_Recv(sock, buffer, 8) < 8)
         error = true;
-    return ntohd(*(double *)buffer);
+    received += 8;
+    double val;
+    memcpy(&val, buffer, sizeof(val));
+    return ntohd(val);
 }
 
 void Socket::send(char *buffer, int size) {
     if (SDLNet_TCP_Send(sock, buffer, size) < size)
         error = true;
+    sent += size;
 }
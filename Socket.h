@@ -7,11 +7,14 @@
 class Socket {
 public:
     bool error;
+    // Bytes received and sent (for PerfHUD), until they're reset.
+    unsigned long received, sent;
 
     Socket(TCPsocket sock);
     ~Socket();
     bool ready(int timeout=0);
     char getByte();
+    Uint16 getUint16();
     Uint64 getUint64();
     double getDouble();
     void send(char *buffer, int size);
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <math.h>
+#include "SpatialGrid.h"
+
+bool AABB::overlaps(const AABB &other) const {
+    return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+}
+
+SpatialGrid::SpatialGrid() : originX(0), originY(0), cellSize(1), cols(0), rows(0), stamp(0) {}
+
+void SpatialGrid::build(const std::vector<AABB> &boxes) {
+    this->boxes = boxes;
+    stamps.assign(boxes.size(), stamp);
+
+    if (boxes.empty()) {
+        cols = rows = 0;
+        cellStart.assign(1, 0);
+        cellItems.clear();
+        return;
+    }
+
+    AABB bounds = boxes[0];
+    double maxExtent = 0;
+    for (const AABB &box : boxes) {
+        bounds.minX = std::min(bounds.minX, box.minX);
+        bounds.minY = std::min(bounds.minY, box.minY);
+        bounds.maxX = std::max(bounds.maxX, box.maxX);
+        bounds.maxY = std::max(bounds.maxY, box.maxY);
+        maxExtent = std::max(maxExtent, std::max(box.maxX - box.minX, box.maxY - box.minY));
+    }
+
+    // Aim for a handful of cells per box, but don't make cells smaller
+    // than the biggest box (which would just put it in many of them).
+    double width = bounds.maxX - bounds.minX, height = bounds.maxY - bounds.minY;
+    cellSize = std::max(maxExtent, sqrt(width * height / (4 * boxes.size())));
+    if (!(cellSize > 0))
+        cellSize = 1;
+
+    originX = bounds.minX;
+    originY = bounds.minY;
+    cols = (int)(width / cellSize) + 1;
+    rows = (int)(height / cellSize) + 1;
+
+    // Counting sort of box indices into cells.
+    cellStart.assign(cols * rows + 1, 0);
+    int x0, y0, x1, y1;
+    for (const AABB &box : boxes) {
+        getCells(box, x0, y0, x1, y1);
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                cellStart[y * cols + x + 1]++;
+    }
+
+    for (int c = 0; c < cols * rows; c++)
+        cellStart[c+1] += cellStart[c];
+
+    cellItems.resize(cellStart[cols * rows]);
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for (unsigned int i = 0; i < boxes.size(); i++) {
+        getCells(boxes[i], x0, y0, x1, y1);
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                cellItems[fill[y * cols + x]++] = i;
+    }
+}
+
+void SpatialGrid::query(const AABB &box, std::vector<int> &out) const {
+    if (boxes.empty())
+        return;
+
+    stamp++;
+    unsigned int start = out.size();
+    int x0, y0, x1, y1;
+    getCells(box, x0, y0, x1, y1);
+
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            for (int c = cellStart[y * cols + x]; c < cellStart[y * cols + x + 1]; c++) {
+                int i = cellItems[c];
+                if (stamps[i] != stamp && boxes[i].overlaps(box)) {
+                    stamps[i] = stamp;
+                    out.push_back(i);
+                }
+            }
+        }
+    }
+
+    std::sort(out.begin() + start, out.end());
+}
+
+// Clamps to the grid, since query boxes may lie partly (or entirely)
+// outside of it.
+void SpatialGrid::getCells(const AABB &box, int &x0, int &y0, int &x1, int &y1) const {
+    x0 = std::max(0, std::min(cols - 1, (int)floor((box.minX - originX) / cellSize)));
+    y0 = std::max(0, std::min(rows - 1, (int)floor((box.minY - originY) / cellSize)));
+    x1 = std::max(0, std::min(cols - 1, (int)floor((box.maxX - originX) / cellSize)));
+    y1 = std::max(0, std::min(rows - 1, (int)floor((box.maxY - originY) / cellSize)));
+}
@@ -0,0 +1,40 @@
+// -*- c++ -*-
+#ifndef PING_SPATIAL_GRID_H
+#define PING_SPATIAL_GRID_H
+
+#include <vector>
+
+// Axis-aligned bounding box.
+struct AABB {
+    double minX, minY, maxX, maxY;
+
+    bool overlaps(const AABB &other) const;
+};
+
+// A uniform grid over a set of boxes, used as a broadphase: it finds
+// the boxes that overlap a query box while only looking at the ones
+// in nearby cells. It's rebuilt from scratch whenever the boxes move,
+// which is cheap since the cells are stored as one flat array.
+class SpatialGrid {
+public:
+    SpatialGrid();
+
+    void build(const std::vector<AABB> &boxes);
+    // Appends the indices of boxes that overlap box to out, in
+    // ascending order.
+    void query(const AABB &box, std::vector<int> &out) const;
+
+private:
+    std::vector<AABB> boxes;
+    double originX, originY, cellSize;
+    int cols, rows;
+    // Items in cell c are cellItems[cellStart[c]] to cellItems[cellStart[c+1]-1].
+    std::vector<int> cellStart, cellItems;
+    // Used to skip boxes that span several cells when querying.
+    mutable std::vector<unsigned int> stamps;
+    mutable unsigned int stamp;
+
+    void getCells(const AABB &box, int &x0, int &y0, int &x1, int &y1) const;
+};
+
+#endif
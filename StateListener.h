@@ -2,10 +2,15 @@
 #ifndef PING_STATE_LISTENER_H
 #define PING_STATE_LISTENER_H
 
+#include "Entity.h"
+
 class StateListener {
 public:
     virtual void onBounce() {}
     virtual void onHit() {}
+    // Called with the ball (and its index) as it goes all the way
+    // through a player's boundary, just before it's reset.
+    virtual void onScore(unsigned int n, const Entity &ball) {}
 };
 
 #endif
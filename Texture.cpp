@@ -2,6 +2,8 @@
 #include "Texture.h"
 #include "utility.h"
 
+unsigned long Texture::uploads = 0, Texture::draws = 0;
+
 Texture::Texture() : w(0), h(0), texture(NULL) {}
 
 Texture::Texture(SDL_Texture *texture, int w, int h) : w(w), h(h), texture(texture) {
@@ -52,6 +54,7 @@ void Texture::render(SDL_Renderer *renderer, int x, int y) {
     if (texture == NULL)
         return;
     SDL_Rect dst = { x, y, w, h };
+    draws++;
     SDL_RenderCopy(renderer, texture, NULL, &dst);
 }
 
@@ -59,6 +62,7 @@ void Texture::render(SDL_Renderer *renderer, int x, int y, int w, int h) {
     if (texture == NULL)
         return;
     SDL_Rect dst = { x, y, w, h };
+    draws++;
     SDL_RenderCopy(renderer, texture, NULL, &dst);
 }
 
@@ -67,21 +71,25 @@ void Texture::render(SDL_Renderer *renderer, int srcX, int srcY, int w, int h, i
         return;
     SDL_Rect src = { srcX, srcY, w, h };
     SDL_Rect dst = { dstX, dstY, w, h };
+    draws++;
     SDL_RenderCopy(renderer, texture, &src, &dst);
 }
 
 void Texture::render(SDL_Renderer *renderer, int x, int y, double angle) {
     SDL_Rect dst = { x, y, w, h };
+    draws++;
     SDL_RenderCopyEx(renderer, texture, NULL, &dst, angle, NULL, SDL_FLIP_NONE);
 }
 
 void Texture::render(SDL_Renderer *renderer, int x, int y, int w, int h, double angle) {
     SDL_Rect dst = { x, y, w, h };
+    draws++;
     SDL_RenderCopyEx(renderer, texture, NULL, &dst, angle, NULL, SDL_FLIP_NONE);
 }
 
 Texture Texture::fromSurface(SDL_Renderer *renderer, SDL_Surface *surface) {
     SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+    uploads++;
     if (texture == NULL)
         SDLerror("SDL_CreateTextureFromSurface");
     return Texture(texture, surface->w, surface->h);
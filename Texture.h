@@ -28,10 +28,19 @@ public:
 
     int w, h;
 
+    // How many textures have been made from surfaces (each of which is
+    // an upload), for PerfHUD.
+    static unsigned long uploads;
+    // How many calls have drawn from textures (through render() or
+    // RenderBatch), for RenderScript's benchmark.
+    static unsigned long draws;
+
     static Texture fromSurface(SDL_Renderer *renderer, SDL_Surface *surface);
     static Texture fromText(SDL_Renderer *renderer, TTF_Font *font, const char *text, Uint8 r=0xff, Uint8 g=0xff, Uint8 b=0xff);
 
 private:
+    friend class RenderBatch;
+
     SDL_Texture *texture;
 };
 
@@ -0,0 +1,37 @@
+// -*- c++ -*-
+#ifndef PING_THREAD_POOL_H
+#define PING_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that run submitted tasks in the order
+// they were submitted. Tasks must not throw.
+class ThreadPool {
+public:
+    // 0 threads means one per hardware thread.
+    explicit ThreadPool(unsigned int numThreads=0);
+    ~ThreadPool();
+
+    unsigned int size() const;
+
+    void submit(std::function<void()> task);
+    // Blocks until every task submitted so far has finished.
+    void wait();
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available, finished;
+    unsigned int running;
+    bool stopping;
+
+    void work();
+};
+
+#endif
@@ -10,7 +10,8 @@ const char *TitleScreen::labels[] = { "Local Game", "Classic Mode", "Network Gam
 std::vector<PaddleInput *> TitleScreen::makeInputs(int n) {
     std::vector<PaddleInput *> inputs(n);
     for (int i = 0; i < n; i++)
-        inputs[i] = new AIInput((AIInput::Difficulty)(rand() % AIInput::NUM_DIFFICULTY));
+        // INSANE's planning is too much to spend on a backdrop.
+        inputs[i] = new AIInput((AIInput::Difficulty)(rand() % (AIInput::HARD + 1)));
 
     return inputs;
 }
@@ -43,8 +44,12 @@ void TitleScreen::update() {
     backgroundGame.update();
 }
 
-void TitleScreen::render(double lag) {
-    backgroundGame.render(lag);
+int TitleScreen::getTickRate() {
+    return backgroundGame.getTickRate();
+}
+
+void TitleScreen::render() {
+    backgroundGame.render();
 
     SDL_SetRenderDrawBlendMode(m->renderer, SDL_BLENDMODE_BLEND);
 
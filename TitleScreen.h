@@ -14,7 +14,8 @@ public:
 
     void handleEvent(SDL_Event &event);
     void update();
-    void render(double lag);
+    int getTickRate();
+    void render();
 
 private:
     enum Button { LOCAL_GAME, CLASSIC_GAME, NETWORK_GAME, TUTORIAL, CREDITS, QUIT, END_BUTTON };
@@ -0,0 +1,54 @@
+// -*- c++ -*-
+#ifndef PING_TRIPLE_BUFFER_H
+#define PING_TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Passes values from one writer thread to one reader thread without
+// locks: the writer fills back() and publish()es it, and the reader
+// picks up the latest published value with update() and reads it from
+// front(). Each side owns its buffer outright until it swaps it for the
+// one in the middle, so neither ever waits for the other, and a reader
+// that falls behind just skips to the newest value.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : backIndex(0), frontIndex(1), middle(2) {}
+
+    T &back() {
+        return buffers[backIndex];
+    }
+
+    void publish() {
+        backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Whether there's a value newer than front().
+    bool fresh() const {
+        return middle.load(std::memory_order_acquire) & FRESH;
+    }
+
+    // Swaps in the newest value, if there is one, returning whether
+    // there was.
+    bool update() {
+        if (!fresh())
+            return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T &front() const {
+        return buffers[frontIndex];
+    }
+
+private:
+    // The middle index's low bits are the buffer, and FRESH is set when
+    // it's been published and not yet read.
+    static const int INDEX = 3, FRESH = 4;
+
+    T buffers[3];
+    int backIndex, frontIndex;
+    std::atomic<int> middle;
+};
+
+#endif
@@ -2,42 +2,118 @@
 #ifndef PING_VECTOR2_H
 #define PING_VECTOR2_H
 
+#include <cmath>
 #include <ostream>
 
-class Vector2 {
+// A 2D vector over scalar type T. Everything is defined here so that it
+// can be inlined into the simulation's inner loops; the operators are
+// friends so that, e.g., a double can be multiplied by a float vector.
+template <class T>
+class BasicVector2 {
 public:
-    double x, y;
+    typedef T Scalar;
 
-    Vector2();
-    Vector2(double x, double y);
+    T x, y;
 
-    double length();
-    double sqrLength();
+    constexpr BasicVector2() : x(0), y(0) {}
+    constexpr BasicVector2(T x, T y) : x(x), y(y) {}
 
-    Vector2 unit();
-    double cross(const Vector2 &other);
+    T length() const {
+        return std::sqrt(x*x + y*y);
+    }
 
-    Vector2 &operator+=(const Vector2 &other);
-    Vector2 &operator-=(const Vector2 &other);
+    // For comparison purposes.
+    constexpr T sqrLength() const {
+        return x*x + y*y;
+    }
 
-    Vector2 &operator*=(double scalar);
-    Vector2 &operator/=(double scalar);
-};
+    BasicVector2 unit() const {
+        T magnitude = length();
+        if (magnitude == 0)
+            return BasicVector2();
+        return BasicVector2(x / magnitude, y / magnitude);
+    }
+
+    constexpr T cross(const BasicVector2 &other) const {
+        return x * other.y - y * other.x;
+    }
+
+    BasicVector2 &operator+=(const BasicVector2 &other) {
+        x += other.x;
+        y += other.y;
+        return *this;
+    }
+
+    BasicVector2 &operator-=(const BasicVector2 &other) {
+        x -= other.x;
+        y -= other.y;
+        return *this;
+    }
+
+    BasicVector2 &operator*=(T scalar) {
+        x *= scalar;
+        y *= scalar;
+        return *this;
+    }
+
+    BasicVector2 &operator/=(T scalar) {
+        x /= scalar;
+        y /= scalar;
+        return *this;
+    }
+
+    friend constexpr bool operator==(const BasicVector2 &a, const BasicVector2 &b) {
+        return a.x == b.x && a.y == b.y;
+    }
 
-bool operator==(const Vector2 &a, const Vector2 &b);
+    friend constexpr BasicVector2 operator+(const BasicVector2 &a, const BasicVector2 &b) {
+        return BasicVector2(a.x + b.x, a.y + b.y);
+    }
 
-Vector2 operator+(Vector2 a, const Vector2 &b);
-Vector2 operator-(Vector2 a, const Vector2 &b);
+    friend constexpr BasicVector2 operator-(const BasicVector2 &a, const BasicVector2 &b) {
+        return BasicVector2(a.x - b.x, a.y - b.y);
+    }
 
-Vector2 operator-(const Vector2 &a);
+    friend constexpr BasicVector2 operator-(const BasicVector2 &a) {
+        return BasicVector2(a.x * -1, a.y * -1);
+    }
 
-Vector2 operator*(Vector2 a, double b);
-Vector2 operator*(double a, Vector2 b);
-Vector2 operator/(Vector2 a, double b);
-Vector2 operator/(double a, Vector2 b);
+    friend constexpr BasicVector2 operator*(const BasicVector2 &a, T b) {
+        return BasicVector2(a.x * b, a.y * b);
+    }
 
-double operator*(const Vector2 &a, const Vector2 &b);
+    friend constexpr BasicVector2 operator*(T a, const BasicVector2 &b) {
+        return BasicVector2(b.x * a, b.y * a);
+    }
 
-std::ostream &operator<<(std::ostream &out, const Vector2 &v);
+    friend constexpr BasicVector2 operator/(const BasicVector2 &a, T b) {
+        return BasicVector2(a.x / b, a.y / b);
+    }
+
+    // NOTE: This divides b by a, like the version above.
+    friend constexpr BasicVector2 operator/(T a, const BasicVector2 &b) {
+        return BasicVector2(b.x / a, b.y / a);
+    }
+
+    // Dot product.
+    friend constexpr T operator*(const BasicVector2 &a, const BasicVector2 &b) {
+        return a.x * b.x + a.y * b.y;
+    }
+
+    friend std::ostream &operator<<(std::ostream &out, const BasicVector2 &v) {
+        out << "(" << v.x << ", " << v.y << ")";
+        return out;
+    }
+};
+
+// Vector2's precision: double by default (which the network code and
+// any stored results assume), or float with PING_FLOAT. Only Vector2
+// arithmetic changes; the entity stores and the SIMD kernels stay in
+// doubles.
+#ifdef PING_FLOAT
+typedef BasicVector2<float> Vector2;
+#else
+typedef BasicVector2<double> Vector2;
+#endif
 
 #endif
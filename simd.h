@@ -0,0 +1,68 @@
+// -*- c++ -*-
+#ifndef PING_SIMD_H
+#define PING_SIMD_H
+
+#include <string.h>
+
+// Thin wrappers around GCC/Clang vector extensions, so that kernels
+// only need one code path: a doublev is an AVX register when AVX is
+// enabled (e.g. with -mavx2) and an SSE2 register on baseline x86-64.
+// PING_SIMD is left undefined for compilers without vector
+// extensions, in which case callers fall back to their scalar loops.
+#if defined(__GNUC__)
+#define PING_SIMD 1
+
+#ifdef __AVX__
+#define SIMD_WIDTH 4
+#else
+#define SIMD_WIDTH 2
+#endif
+
+typedef double doublev __attribute__((vector_size(8 * SIMD_WIDTH)));
+typedef long long longv __attribute__((vector_size(8 * SIMD_WIDTH)));
+
+inline doublev loadv(const double *p) {
+    doublev v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline doublev loadv(const int *p) {
+    doublev v;
+    for (int i = 0; i < SIMD_WIDTH; i++)
+        v[i] = p[i];
+    return v;
+}
+
+inline void storev(double *p, doublev v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+inline doublev broadcastv(double x) {
+    doublev zero = {};
+    return zero + x;
+}
+
+// 32-bit integer lanes in a register of the same size, for sums of
+// quantized values.
+#define SIMD_INT_WIDTH (2 * SIMD_WIDTH)
+
+typedef int intv __attribute__((vector_size(8 * SIMD_WIDTH)));
+
+inline intv loadiv(const int *p) {
+    intv v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void storeiv(int *p, intv v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+inline intv broadcastiv(int x) {
+    intv zero = {};
+    return zero + x;
+}
+#endif
+
+#endif
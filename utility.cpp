@@ -1,6 +1,8 @@
 #include <iostream>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <SDL2/SDL.h>
 #include "utility.h"
 
@@ -50,19 +52,35 @@ Uint64 hton64(Uint64 input) {
 }
 
 double ntohd(double input) {
-    Uint64 tmp = ntoh64(*(Uint64 *)&input);
-    return *(double *)&tmp;
+    return bitsToDouble(ntoh64(doubleToBits(input)));
 }
 
 double htond(double input) {
     return ntohd(input);
 }
 
+// Copied rather than cast, which would break strict aliasing.
+Uint64 doubleToBits(double x) {
+    Uint64 bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+double bitsToDouble(Uint64 bits) {
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+double threadCPUSeconds() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
 // maxLen and cutLen default to 0 (see utility.h).
-const char *getShortKeyName(SDL_Keycode key, int maxLen, int cutLen) {
-    static std::string name;
-    const char *longName = SDL_GetKeyName(key);
-    name = longName;
+std::string getShortKeyName(SDL_Keycode key, int maxLen, int cutLen) {
+    std::string name = SDL_GetKeyName(key);
 
     size_t pos;
     if ((pos = name.find("Left ")) != std::string::npos)
@@ -79,5 +97,5 @@ const char *getShortKeyName(SDL_Keycode key, int maxLen, int cutLen) {
         name += "...";
     }
 
-    return name.c_str();
+    return name;
 }
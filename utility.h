@@ -1,6 +1,7 @@
 #ifndef PING_UTILITY_H
 #define PING_UTILITY_H
 
+#include <string>
 #include <SDL2/SDL_net.h>
 #include "Entity.h"
 
@@ -18,7 +19,13 @@ Uint64 ntoh64(Uint64 input);
 Uint64 hton64(Uint64 input);
 double ntohd(double input);
 double htond(double input);
+// A double's bits as an integer (for sending it), and back again.
+Uint64 doubleToBits(double x);
+double bitsToDouble(Uint64 bits);
 
-const char *getShortKeyName(SDL_Keycode key, int maxLen=0, int cutLen=0);
+std::string getShortKeyName(SDL_Keycode key, int maxLen=0, int cutLen=0);
+
+// The CPU time the calling thread has used, in seconds.
+double threadCPUSeconds();
 
 #endif